@@ -0,0 +1,280 @@
+/* Deterministic synthetic compare corpus for the diff engine benchmarks
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+
+#include "diff_types.h"
+
+
+// Same element types the engine compares (see Engine.cpp) - only the hash matters to the diff algorithms
+using LineId	= dense_id_type<uint32_t>;
+using WordId	= hash_type<uint64_t>;
+using CharId	= hash_type<wchar_t>;
+
+
+template <typename Elem>
+struct CorpusCase
+{
+	std::string name;
+
+	// Compared sequence pairs - one big pair for the line cases, many small ones for the word and char cases
+	std::vector<std::pair<std::vector<Elem>, std::vector<Elem>>> pairs;
+};
+
+
+namespace corpus
+{
+
+// Line IDs of code-like text - 'commonPercent' of the lines are few often repeated ones (blank, braces, 'break;',
+// 'end' and alike), the rest come from a vocabulary of 'vocab' distinct lines
+class LineSource
+{
+public:
+	LineSource(uint32_t seed, uint32_t vocab, int commonPercent, uint32_t commonCount = 8) :
+		_rnd(seed), _vocab(vocab), _commonPercent(commonPercent), _commonCount(commonCount) {};
+
+	LineId next()
+	{
+		if (static_cast<int>(_rnd() % 100) < _commonPercent)
+			return LineId(_rnd() % _commonCount);
+
+		return LineId(_commonCount + _rnd() % _vocab);
+	};
+
+	// A line no other source gives
+	LineId fresh() { return LineId(_freshId++); };
+
+	std::mt19937& rnd() { return _rnd; };
+
+private:
+	std::mt19937 _rnd;
+
+	uint32_t _vocab;
+	int _commonPercent;
+	uint32_t _commonCount;
+
+	uint32_t _freshId {0x40000000};
+};
+
+
+// Copies 'a' applying 'hunks' random edits of up to 'maxHunkLen' lines - replaced, inserted or deleted
+inline std::vector<LineId> editLines(const std::vector<LineId>& a, LineSource& src, intptr_t hunks,
+	intptr_t maxHunkLen)
+{
+	std::mt19937& rnd = src.rnd();
+
+	std::vector<intptr_t> hunkPos(hunks);
+
+	for (auto& p : hunkPos)
+		p = static_cast<intptr_t>(rnd() % a.size());
+
+	std::sort(hunkPos.begin(), hunkPos.end());
+
+	std::vector<LineId> b;
+	b.reserve(a.size() + hunks * maxHunkLen);
+
+	intptr_t i = 0;
+
+	for (intptr_t p : hunkPos)
+	{
+		if (p < i)
+			continue;
+
+		b.insert(b.end(), a.begin() + i, a.begin() + p);
+		i = p;
+
+		const intptr_t len = 1 + rnd() % maxHunkLen;
+		const int kind = rnd() % 3;
+
+		// Replace or delete
+		if (kind != 1)
+			i = std::min(i + len, static_cast<intptr_t>(a.size()));
+
+		// Replace or insert
+		if (kind != 2)
+		{
+			for (intptr_t l = 0; l < len; ++l)
+				b.push_back(rnd() % 2 ? src.fresh() : src.next());
+		}
+	}
+
+	b.insert(b.end(), a.begin() + i, a.end());
+
+	return b;
+}
+
+
+inline std::vector<LineId> makeLines(LineSource& src, intptr_t count)
+{
+	std::vector<LineId> lines;
+	lines.reserve(count);
+
+	for (intptr_t i = 0; i < count; ++i)
+		lines.push_back(src.next());
+
+	return lines;
+}
+
+
+// The line compare cases - 'scale' multiplies their sizes
+inline std::vector<CorpusCase<LineId>> lineCases(intptr_t scale)
+{
+	std::vector<CorpusCase<LineId>> cases;
+
+	auto addCase = [&](const char* name, std::vector<LineId>&& a, std::vector<LineId>&& b)
+	{
+		cases.push_back({ name, {} });
+		cases.back().pairs.emplace_back(std::move(a), std::move(b));
+	};
+
+	// Source code with a few scattered edits
+	{
+		LineSource src(1, 1000000, 30);
+		auto a = makeLines(src, 20000 * scale);
+		auto b = editLines(a, src, 60 * scale, 6);
+
+		addCase("code-sparse-edits", std::move(a), std::move(b));
+	}
+
+	// Source code with many edits
+	{
+		LineSource src(2, 1000000, 30);
+		auto a = makeLines(src, 20000 * scale);
+		auto b = editLines(a, src, 2000 * scale, 10);
+
+		addCase("code-dense-edits", std::move(a), std::move(b));
+	}
+
+	// Source code with some blocks moved around
+	{
+		LineSource src(3, 1000000, 30);
+		auto a = makeLines(src, 20000 * scale);
+		auto b = a;
+
+		for (int m = 0; m < 20; ++m)
+		{
+			const intptr_t len = 50 + src.rnd()() % 400;
+			const intptr_t from = src.rnd()() % (b.size() - len);
+			std::vector<LineId> block(b.begin() + from, b.begin() + from + len);
+
+			b.erase(b.begin() + from, b.begin() + from + len);
+			b.insert(b.begin() + src.rnd()() % b.size(), block.begin(), block.end());
+		}
+
+		b = editLines(b, src, 20 * scale, 4);
+
+		addCase("code-moved-blocks", std::move(a), std::move(b));
+	}
+
+	// A middle section rewritten from the same (small) vocabulary
+	{
+		LineSource src(4, 3000, 30);
+		auto a = makeLines(src, 5000 * scale);
+		auto b = a;
+		auto section = makeLines(src, 2000 * scale);
+
+		std::copy(section.begin(), section.end(), b.begin() + 1500 * scale);
+
+		addCase("code-rewrite", std::move(a), std::move(b));
+	}
+
+	// Much added to one side only
+	{
+		LineSource src(5, 1000000, 30);
+		auto a = makeLines(src, 3000 * scale);
+		auto b = a;
+
+		for (int ins = 0; ins < 10; ++ins)
+		{
+			auto added = makeLines(src, 1500 * scale);
+			b.insert(b.begin() + src.rnd()() % b.size(), added.begin(), added.end());
+		}
+
+		addCase("asymmetric-inserts", std::move(a), std::move(b));
+	}
+
+	// Log or data table like text - few distinct lines, each much repeated
+	{
+		LineSource src(6, 40, 50);
+		auto a = makeLines(src, 20000 * scale);
+		auto b = editLines(a, src, 1000 * scale, 8);
+
+		addCase("repeated-lines", std::move(a), std::move(b));
+	}
+
+	// Repeated lines mixed with distinct ones
+	{
+		LineSource src(7, 3000, 60, 30);
+		auto a = makeLines(src, 20000 * scale);
+		auto b = editLines(a, src, 1500 * scale, 8);
+
+		addCase("mixed-repeats", std::move(a), std::move(b));
+	}
+
+	// Completely different texts sharing only the common lines
+	{
+		LineSource src(8, 1000000, 30);
+		auto a = makeLines(src, 4000 * scale);
+		auto b = makeLines(src, 4000 * scale);
+
+		addCase("distinct-rewrite", std::move(a), std::move(b));
+	}
+
+	return cases;
+}
+
+
+// Many short sequences pairs of 'Elem' drawn from 'alphabet' symbols, 'changePercent' of their elements changed
+template <typename Elem>
+CorpusCase<Elem> shortPairs(const char* name, uint32_t seed, intptr_t pairsCount, intptr_t minLen, intptr_t maxLen,
+	uint32_t alphabet, int changePercent)
+{
+	std::mt19937 rnd(seed);
+
+	CorpusCase<Elem> c { name, {} };
+
+	c.pairs.reserve(pairsCount);
+
+	for (intptr_t p = 0; p < pairsCount; ++p)
+	{
+		const intptr_t len = minLen + rnd() % (maxLen - minLen + 1);
+
+		std::vector<Elem> a;
+		std::vector<Elem> b;
+
+		for (intptr_t i = 0; i < len; ++i)
+			a.emplace_back(static_cast<typename Elem::HashType>(1 + rnd() % alphabet));
+
+		for (intptr_t i = 0; i < len; ++i)
+		{
+			if (static_cast<int>(rnd() % 100) >= changePercent)
+			{
+				b.push_back(a[i]);
+				continue;
+			}
+
+			const int kind = rnd() % 3;
+
+			// Replaced, inserted after or deleted
+			if (kind == 1)
+				b.push_back(a[i]);
+
+			if (kind != 2)
+				b.emplace_back(static_cast<typename Elem::HashType>(1 + rnd() % alphabet));
+		}
+
+		c.pairs.emplace_back(std::move(a), std::move(b));
+	}
+
+	return c;
+}
+
+} // namespace corpus
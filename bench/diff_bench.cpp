@@ -0,0 +1,366 @@
+/* Quality and time benchmarks of the diff engine on a deterministic corpus (see corpus.h)
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ * Usage:
+ *	diff_bench swap [scale]
+ *		Runs every diff algorithm on the corpus with the swapped sequences run skipped when it cannot give more
+ *		replaces (as DiffCalc does) and with it always run. Prints the times and the skipped runs share (of the
+ *		pairs that differ).
+ *		Fails (exit code 1) if any result differs.
+ *
+ *	diff_bench auto [scale] [fileA fileB]...
+ *		Compares the corpus line cases (and the given files' lines) by every line diff algorithm and by AUTO, at
+ *		full and at bounded cost. Prints the times, the changed lines count and what AUTO picked - the corpus to
+ *		tune DiffCalc's AUTO selection against. Fails (exit code 1) if AUTO switched to bounded cost on its own.
+ */
+
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <fstream>
+#include <unordered_map>
+
+#include "diff.h"
+#include "corpus.h"
+
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+
+inline double msSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+inline bool sameDiffs(const diff_results& d1, const diff_results& d2)
+{
+	if (d1.size() != d2.size())
+		return false;
+
+	for (size_t i = 0; i < d1.size(); ++i)
+	{
+		if (d1[i].a.s != d2[i].a.s || d1[i].a.e != d2[i].a.e || d1[i].b.s != d2[i].b.s || d1[i].b.e != d2[i].b.e)
+			return false;
+	}
+
+	return true;
+}
+
+
+// Mirrors the sequential swap check of DiffCalc::_run_algo() - if 'fullCheck' is set the swapped sequences run is
+// never skipped. Returns true if the swapped run was done.
+template <typename Elem>
+bool runSwapCheck(diff_algorithm<Elem>& alg, const std::vector<Elem>& va, const std::vector<Elem>& vb,
+	bool fullCheck, diff_results& diffs, diff_results& swappedDiffs)
+{
+	diffs.clear();
+	swappedDiffs.clear();
+
+	const Elem* a = va.data();
+	const Elem* b = vb.data();
+	intptr_t asize = static_cast<intptr_t>(va.size());
+	intptr_t bsize = static_cast<intptr_t>(vb.size());
+
+	intptr_t off_s = 0;
+
+	while (off_s < asize && off_s < bsize && a[off_s] == b[off_s])
+		++off_s;
+
+	if (asize == bsize && off_s == asize)
+		return false;
+
+	const intptr_t aend = asize - 1;
+	const intptr_t bend = bsize - 1;
+
+	asize -= off_s;
+	bsize -= off_s;
+
+	intptr_t off_e = 0;
+
+	while (off_e < asize && off_e < bsize && a[aend - off_e] == b[bend - off_e])
+		++off_e;
+
+	asize -= off_e;
+	bsize -= off_e;
+
+	alg.run(a, asize, b, bsize, diffs, off_s);
+
+	const bool swappedRun =
+			(fullCheck || alg.needFullSwapCheck() || diffs.count_replaces() < diffs.count_max_replaces());
+
+	if (swappedRun)
+		alg.run(b, bsize, a, asize, swappedDiffs, off_s);
+
+	const intptr_t swapped_replaces = swappedDiffs.count_replaces();
+
+	if (swapped_replaces && swapped_replaces > diffs.count_replaces())
+	{
+		diffs.swap(swappedDiffs);
+		diffs.swap_ab();
+	}
+
+	return swappedRun;
+}
+
+
+template <typename Elem>
+struct AlgConfig
+{
+	const char* name;
+	std::function<std::unique_ptr<diff_algorithm<Elem>>(DiffWorkspace&)> make;
+	bool bitLcs;
+};
+
+
+template <typename Elem>
+std::vector<AlgConfig<Elem>> swapCheckAlgs(bool withBitLcs)
+{
+	std::vector<AlgConfig<Elem>> algs {
+		{ "MYERS", [](DiffWorkspace& ws) { return std::make_unique<MyersDiff<Elem>>(nullptr, &ws, false); }, false },
+		{ "MYERS bounded",
+				[](DiffWorkspace& ws) { return std::make_unique<MyersDiff<Elem>>(nullptr, &ws, true); }, false },
+		{ "HISTOGRAM",
+				[](DiffWorkspace& ws) { return std::make_unique<HistogramDiff<Elem>>(nullptr, 250, &ws); }, false },
+		{ "MIXED histogram",
+				[](DiffWorkspace& ws) { return std::make_unique<HistogramDiff<Elem>>(nullptr, 1, &ws); }, false },
+		{ "PATIENCE",
+				[](DiffWorkspace& ws) { return std::make_unique<PatienceDiff<Elem>>(nullptr, &ws, false); }, false },
+		{ "PATIENCE bounded",
+				[](DiffWorkspace& ws) { return std::make_unique<PatienceDiff<Elem>>(nullptr, &ws, true); }, false }
+	};
+
+	if (withBitLcs)
+		algs.push_back({ "BIT_LCS",
+				[](DiffWorkspace& ws) { return std::make_unique<BitLcsDiff<Elem>>(nullptr, &ws); }, true });
+
+	return algs;
+}
+
+
+// Returns the count of the pairs with different results
+template <typename Elem>
+intptr_t benchSwapCheck(const CorpusCase<Elem>& c, bool withBitLcs)
+{
+	intptr_t mismatches = 0;
+
+	for (const auto& cfg : swapCheckAlgs<Elem>(withBitLcs))
+	{
+		DiffWorkspace ws;
+		auto alg = cfg.make(ws);
+
+		std::vector<diff_results> fullResults;
+		diff_results diffs;
+		diff_results swappedDiffs;
+
+		intptr_t pairs = 0;
+
+		Clock::time_point start = Clock::now();
+
+		for (const auto& p : c.pairs)
+		{
+			if (cfg.bitLcs && !BitLcsDiff<Elem>::canRun(p.first.size(), p.second.size()))
+				continue;
+
+			runSwapCheck(*alg, p.first, p.second, true, diffs, swappedDiffs);
+			fullResults.emplace_back().swap(diffs);
+			++pairs;
+		}
+
+		const double fullMs = msSince(start);
+
+		intptr_t changedPairs = 0;
+		intptr_t swappedRuns = 0;
+		intptr_t differing = 0;
+		size_t ri = 0;
+
+		start = Clock::now();
+
+		for (const auto& p : c.pairs)
+		{
+			if (cfg.bitLcs && !BitLcsDiff<Elem>::canRun(p.first.size(), p.second.size()))
+				continue;
+
+			if (runSwapCheck(*alg, p.first, p.second, false, diffs, swappedDiffs))
+				++swappedRuns;
+
+			if (!fullResults[ri].empty())
+				++changedPairs;
+
+			if (!sameDiffs(diffs, fullResults[ri++]))
+				++differing;
+		}
+
+		const double skipMs = msSince(start);
+
+		std::printf("%-20s %-17s %6lld pairs  always: %9.1f ms  skipping: %9.1f ms  skipped %5.1f%%  %s\n",
+				c.name.c_str(), cfg.name, static_cast<long long>(pairs), fullMs, skipMs,
+				changedPairs ? 100.0 * (changedPairs - swappedRuns) / changedPairs : 0.0,
+				differing ? "DIFFERENT" : "same");
+
+		mismatches += differing;
+	}
+
+	return mismatches;
+}
+
+
+int runSwapBench(intptr_t scale)
+{
+	intptr_t mismatches = 0;
+
+	for (const auto& c : corpus::lineCases(scale))
+		mismatches += benchSwapCheck(c, false);
+
+	mismatches += benchSwapCheck(corpus::shortPairs<WordId>("words", 11, 3000 * scale, 5, 60, 400, 10), true);
+	mismatches += benchSwapCheck(corpus::shortPairs<CharId>("chars", 12, 3000 * scale, 10, 120, 60, 10), true);
+	mismatches += benchSwapCheck(
+			corpus::shortPairs<CharId>("chars-much-changed", 13, 3000 * scale, 10, 120, 30, 50), true);
+
+	if (mismatches)
+		std::printf("\n%lld results differ from the always run swap check!\n", static_cast<long long>(mismatches));
+
+	return mismatches ? 1 : 0;
+}
+
+// Changed elements count (a and b) - the diff quality measure, less is better
+inline intptr_t diffCost(const diff_results& diffs)
+{
+	intptr_t cost = 0;
+
+	for (const auto& d : diffs)
+		cost += d.a.len() + d.b.len();
+
+	return cost;
+}
+
+
+// Reads the file's lines as line IDs - equal lines in all files read get the same ID
+bool readLines(const char* file, std::unordered_map<std::string, uint32_t>& ids, std::vector<LineId>& lines)
+{
+	std::ifstream in(file, std::ios::binary);
+
+	if (!in)
+		return false;
+
+	std::string line;
+
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		lines.emplace_back(ids.emplace(line, static_cast<uint32_t>(ids.size())).first->second);
+	}
+
+	return true;
+}
+
+
+// Returns false if AUTO switched to bounded cost on its own
+bool benchAuto(const CorpusCase<LineId>& c)
+{
+	static const DiffAlg algs[] = {
+		DiffAlg::MYERS, DiffAlg::HISTOGRAM, DiffAlg::MIXED, DiffAlg::PATIENCE, DiffAlg::AUTO
+	};
+
+	const auto& p = c.pairs.front();
+
+	bool ok = true;
+
+	std::printf("%s (%lld / %lld lines)\n", c.name.c_str(), static_cast<long long>(p.first.size()),
+			static_cast<long long>(p.second.size()));
+
+	for (bool bounded : { false, true })
+	{
+		for (DiffAlg alg : algs)
+		{
+			DiffCalc<LineId> diffCalc(p.first, p.second, nullptr, nullptr, bounded);
+
+			const Clock::time_point start = Clock::now();
+			const diff_results diffs = diffCalc(alg, true, true);
+			const double ms = msSince(start);
+
+			std::printf("    %-10s %-8s %9.1f ms  changed %8lld", diff_alg_name(alg), bounded ? "bounded" : "",
+					ms, static_cast<long long>(diffCost(diffs)));
+
+			if (alg == DiffAlg::AUTO)
+			{
+				std::printf("  -> %s%s", diff_alg_name(diffCalc.selected_alg()),
+						diffCalc.selected_bounded() ? " (bounded)" : "");
+
+				if (diffCalc.selected_bounded() && !bounded)
+				{
+					std::printf("  BOUNDED COST NOT ALLOWED");
+					ok = false;
+				}
+			}
+
+			std::printf("\n");
+		}
+	}
+
+	return ok;
+}
+
+
+int runAutoBench(intptr_t scale, int filesCount, char* files[])
+{
+	bool ok = true;
+
+	for (const auto& c : corpus::lineCases(scale))
+		ok = benchAuto(c) && ok;
+
+	std::unordered_map<std::string, uint32_t> ids;
+
+	for (int f = 0; f + 1 < filesCount; f += 2)
+	{
+		CorpusCase<LineId> c { std::string(files[f]) + " - " + files[f + 1], {} };
+
+		c.pairs.emplace_back();
+
+		if (!readLines(files[f], ids, c.pairs.back().first) || !readLines(files[f + 1], ids, c.pairs.back().second))
+		{
+			std::fprintf(stderr, "Cannot read %s\n", c.name.c_str());
+			return 2;
+		}
+
+		ok = benchAuto(c) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s swap [scale]\n       %s auto [scale] [fileA fileB]...\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	const intptr_t scale = (argc > 2) ? std::max(1LL, std::strtoll(argv[2], nullptr, 10)) : 1;
+
+	if (!std::strcmp(argv[1], "swap"))
+		return runSwapBench(scale);
+
+	if (!std::strcmp(argv[1], "auto"))
+		return runAutoBench(scale, std::max(argc - 3, 0), argv + 3);
+
+	std::fprintf(stderr, "Unknown benchmark '%s'\n", argv[1]);
+
+	return 2;
+}
@@ -0,0 +1,589 @@
+/* Time benchmarks of the diff engine hashing on deterministic synthetic data
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ * Usage:
+ *	hash_bench line [scale]
+ *		Hashes synthetic source and log lines by LineHasher and by the byte-serial Hash() it replaced - plain, with
+ *		all spaces ignored and with changed spaces ignored (collapsed and trimmed) as getLines() does. Prints the
+ *		throughputs. Fails (exit code 1) if LineHasher differs from the reference XXH64, if hashing the text in parts
+ *		differs from hashing it at once or if the spaces handling differs from hashing the normalized text.
+ *
+ *	hash_bench map [scale]
+ *		Runs the engine's hash lookups on a million line hashes (70% unique, 80% of B found in A) by FlatHashMap and
+ *		by std::unordered_map - grouping A's lines per hash and joining B's lines to them (as findUniqueLines() did
+ *		before the lines were interned) and HistogramDiff's amap build and lookups. The maps are reused between the
+ *		runs as the engine does, the best run times are printed. Fails (exit code 1) if the results differ.
+ */
+
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
+
+#include "line_hash.h"
+#include "flat_hash_map.h"
+
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+
+inline double msSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+// Same as in Engine.cpp
+constexpr uint64_t cHashSeed = 0x84222325;
+
+
+// The per char hash the engine used before LineHasher
+inline uint64_t Hash(uint64_t hval, char letter)
+{
+	hval ^= static_cast<uint64_t>(letter);
+
+	hval += (hval << 1) + (hval << 4) + (hval << 5) + (hval << 7) + (hval << 8) + (hval << 40);
+
+	return hval;
+}
+
+
+inline bool isSpace(char c)
+{
+	return (c == ' ' || c == '\t');
+}
+
+
+// The line hashing loop getLines() used before LineHasher
+uint64_t oldLineHash(std::string_view line, bool ignoreAllSpaces, bool ignoreChangedSpaces)
+{
+	uint64_t hash = cHashSeed;
+
+	size_t pos = 0;
+	size_t endPos = line.size();
+
+	if (ignoreChangedSpaces)
+	{
+		while (pos < endPos && isSpace(line[pos]))
+			++pos;
+
+		while (endPos > pos && isSpace(line[endPos - 1]))
+			--endPos;
+	}
+
+	for (; pos < endPos; ++pos)
+	{
+		if (ignoreAllSpaces && isSpace(line[pos]))
+			continue;
+
+		if (ignoreChangedSpaces && isSpace(line[pos]))
+		{
+			hash = Hash(hash, ' ');
+
+			while (++pos < endPos && isSpace(line[pos]));
+
+			if (pos == endPos)
+				break;
+		}
+
+		hash = Hash(hash, line[pos]);
+	}
+
+	return hash;
+}
+
+
+uint64_t newLineHash(std::string_view line, bool ignoreAllSpaces, bool ignoreChangedSpaces)
+{
+	LineHasher hasher(cHashSeed);
+
+	if (ignoreAllSpaces)
+		hasher.updateIgnoreSpaces(line.data(), line.size());
+	else if (ignoreChangedSpaces)
+		hasher.updateCollapseSpaces(line.data(), line.size(), true);
+	else
+		hasher.update(line.data(), line.size());
+
+	return hasher.digest();
+}
+
+
+// One-shot XXH64 written straight from the specification - the reference LineHasher is checked against
+uint64_t refXXH64(const uint8_t* p, size_t len, uint64_t seed)
+{
+	constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+	constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+	constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+	constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+	auto read64 = [](const uint8_t* s) { uint64_t v; std::memcpy(&v, s, 8); return v; };
+	auto read32 = [](const uint8_t* s) { uint32_t v; std::memcpy(&v, s, 4); return v; };
+	auto round = [](uint64_t acc, uint64_t in) { return std::rotl(acc + in * P2, 31) * P1; };
+
+	const uint8_t* const end = p + len;
+	uint64_t h;
+
+	if (len >= 32)
+	{
+		uint64_t v[4] = { seed + P1 + P2, seed + P2, seed, seed - P1 };
+
+		for (; end - p >= 32; p += 32)
+		{
+			for (int i = 0; i < 4; ++i)
+				v[i] = round(v[i], read64(p + i * 8));
+		}
+
+		h = std::rotl(v[0], 1) + std::rotl(v[1], 7) + std::rotl(v[2], 12) + std::rotl(v[3], 18);
+
+		for (int i = 0; i < 4; ++i)
+			h = (h ^ round(0, v[i])) * P1 + P4;
+	}
+	else
+	{
+		h = seed + P5;
+	}
+
+	h += len;
+
+	for (; end - p >= 8; p += 8)
+		h = std::rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+
+	if (end - p >= 4)
+	{
+		h = std::rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+		p += 4;
+	}
+
+	for (; p < end; ++p)
+		h = std::rotl(h ^ (*p * P5), 11) * P1;
+
+	h ^= h >> 33;
+	h *= P2;
+	h ^= h >> 29;
+	h *= P3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+
+// Source code like lines (indented, tokens separated by single spaces and sometimes by runs of spaces and tabs)
+// and some long log lines
+std::vector<std::string> makeTextLines(uint32_t seed, size_t count)
+{
+	static const char* const tokens[] = {
+		"if", "(", ")", "{", "}", "return", "const", "auto&", "=", "==", "+=", "std::vector<intptr_t>", "i", "++i",
+		"for", "while", "nullptr", "static_cast<int>(len)", "//", "the", "line", "hash", "of", "text", ";",
+		"0x84222325", "ERROR", "[2026-10-17 01:47:41.123]", "thread", "compare", "done", "ms", "->", "buffId",
+		"docsLineHashes"
+	};
+
+	std::mt19937 rnd(seed);
+	std::vector<std::string> lines(count);
+
+	for (std::string& line : lines)
+	{
+		const bool logLine = (rnd() % 10 == 0);
+		const size_t tokensCount = logLine ? 30 + rnd() % 50 : rnd() % 14;
+
+		if (!logLine)
+			line.append(rnd() % 7, (rnd() % 3) ? '\t' : ' ');
+
+		for (size_t t = 0; t < tokensCount; ++t)
+		{
+			if (t)
+			{
+				if (rnd() % 8 == 0)
+					line.append(1 + rnd() % 4, (rnd() % 2) ? '\t' : ' ');
+				else
+					line += ' ';
+			}
+
+			line += tokens[rnd() % std::size(tokens)];
+		}
+
+		if (rnd() % 16 == 0)
+			line.append(1 + rnd() % 3, ' ');
+	}
+
+	return lines;
+}
+
+
+std::string normalizedSpaces(std::string_view line, bool ignoreAllSpaces)
+{
+	std::string norm;
+
+	size_t pos = 0;
+	size_t endPos = line.size();
+
+	if (!ignoreAllSpaces)
+	{
+		while (pos < endPos && isSpace(line[pos]))
+			++pos;
+
+		while (endPos > pos && isSpace(line[endPos - 1]))
+			--endPos;
+	}
+
+	for (; pos < endPos; ++pos)
+	{
+		if (!isSpace(line[pos]))
+			norm += line[pos];
+		else if (!ignoreAllSpaces && (norm.empty() || norm.back() != ' '))
+			norm += ' ';
+	}
+
+	return norm;
+}
+
+
+bool checkLineHasher(const std::vector<std::string>& lines)
+{
+	const uint8_t abc[] = { 'a', 'b', 'c' };
+
+	// The published XXH64 test vector
+	if (refXXH64(abc, 3, 0) != 0x44BC2CF5AD770999ULL)
+	{
+		std::printf("Reference XXH64 is wrong\n");
+		return false;
+	}
+
+	std::mt19937 rnd(7);
+
+	for (const std::string& line : lines)
+	{
+		if (line.empty())
+			continue;
+
+		const uint64_t whole = newLineHash(line, false, false);
+
+		if (whole != refXXH64(reinterpret_cast<const uint8_t*>(line.data()), line.size(), cHashSeed))
+		{
+			std::printf("LineHasher differs from XXH64 on '%s'\n", line.c_str());
+			return false;
+		}
+
+		LineHasher parts(cHashSeed);
+
+		for (size_t pos = 0; pos < line.size();)
+		{
+			const size_t len = std::min(line.size() - pos, static_cast<size_t>(1 + rnd() % 40));
+
+			parts.update(line.data() + pos, len);
+			pos += len;
+		}
+
+		if (parts.digest() != whole)
+		{
+			std::printf("LineHasher in parts differs on '%s'\n", line.c_str());
+			return false;
+		}
+
+		for (bool ignoreAllSpaces : { true, false })
+		{
+			const std::string norm = normalizedSpaces(line, ignoreAllSpaces);
+
+			if (newLineHash(line, ignoreAllSpaces, !ignoreAllSpaces) != newLineHash(norm, false, false))
+			{
+				std::printf("LineHasher %s differs on '%s'\n",
+						ignoreAllSpaces ? "ignoring spaces" : "collapsing spaces", line.c_str());
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+template <typename HashFn>
+double hashThroughput(const std::vector<std::string>& lines, size_t bytes, int passes, HashFn hashFn,
+	uint64_t& check)
+{
+	const Clock::time_point start = Clock::now();
+
+	for (int p = 0; p < passes; ++p)
+	{
+		for (const std::string& line : lines)
+			check ^= hashFn(line);
+	}
+
+	return (static_cast<double>(bytes) * passes / (1024 * 1024)) / (msSince(start) / 1000);
+}
+
+
+int runLineBench(intptr_t scale)
+{
+	const std::vector<std::string> lines = makeTextLines(3, static_cast<size_t>(200000 * scale));
+
+	size_t bytes = 0;
+
+	for (const std::string& line : lines)
+		bytes += line.size();
+
+	std::printf("%lld lines, %.1f MB\n", static_cast<long long>(lines.size()),
+			static_cast<double>(bytes) / (1024 * 1024));
+
+	if (!checkLineHasher(lines))
+		return 1;
+
+	constexpr int cPasses = 5;
+
+	static const struct { const char* name; bool ignoreAllSpaces; bool ignoreChangedSpaces; } modes[] = {
+		{ "plain", false, false },
+		{ "ignore spaces", true, false },
+		{ "collapse spaces", false, true }
+	};
+
+	// Keeps the hashing from being optimized away
+	uint64_t check = 0;
+
+	for (const auto& m : modes)
+	{
+		const double oldMBs = hashThroughput(lines, bytes, cPasses,
+				[&](const std::string& l) { return oldLineHash(l, m.ignoreAllSpaces, m.ignoreChangedSpaces); }, check);
+		const double newMBs = hashThroughput(lines, bytes, cPasses,
+				[&](const std::string& l) { return newLineHash(l, m.ignoreAllSpaces, m.ignoreChangedSpaces); }, check);
+
+		std::printf("    %-16s Hash() %8.1f MB/s   LineHasher %8.1f MB/s   x%.2f\n", m.name, oldMBs, newMBs,
+				newMBs / oldMBs);
+	}
+
+	std::printf("(check %016llx)\n", static_cast<unsigned long long>(check));
+
+	return 0;
+}
+
+
+// Line hashes of two docs - 'uniquePercent' of A's lines are unique, the rest are repeated ones, 'foundPercent' of
+// B's lines are taken from A, the rest are new
+void makeLineHashes(uint32_t seed, size_t count, int uniquePercent, int foundPercent, std::vector<uint64_t>& a,
+	std::vector<uint64_t>& b)
+{
+	std::mt19937_64 rnd(seed);
+
+	const uint64_t repeatedCount = std::max(count / 100, static_cast<size_t>(1));
+
+	a.resize(count);
+	b.resize(count);
+
+	// Repeated lines get low values so they do not clash with the random unique ones
+	for (uint64_t& h : a)
+		h = (static_cast<int>(rnd() % 100) < uniquePercent) ? rnd() | (1ULL << 63) : rnd() % repeatedCount;
+
+	for (uint64_t& h : b)
+		h = (static_cast<int>(rnd() % 100) < foundPercent) ? a[rnd() % count] : rnd() | (1ULL << 63);
+}
+
+
+template <typename Fn>
+double bestRun_ms(int runs, Fn fn)
+{
+	double best = 0;
+
+	for (int r = 0; r < runs; ++r)
+	{
+		const Clock::time_point start = Clock::now();
+		fn();
+		const double ms = msSince(start);
+
+		if (r == 0 || ms < best)
+			best = ms;
+	}
+
+	return best;
+}
+
+
+int runMapBench(intptr_t scale)
+{
+	const size_t count = static_cast<size_t>(1000000 * scale);
+
+	std::vector<uint64_t> a;
+	std::vector<uint64_t> b;
+
+	makeLineHashes(5, count, 70, 80, a, b);
+
+	std::printf("%lld lines per doc\n", static_cast<long long>(count));
+
+	constexpr int cRuns = 5;
+
+	bool ok = true;
+
+	// Join - groups A's lines per hash, then visits the A lines matched by B lines (each group once)
+	{
+		std::vector<uint8_t> visited;
+
+		std::unordered_map<uint64_t, std::vector<intptr_t>> stdGroups;
+		uint64_t stdCheck = 0;
+
+		const double std_ms = bestRun_ms(cRuns,
+			[&]()
+			{
+				stdGroups.clear();
+				visited.assign(count, 0);
+				stdCheck = 0;
+
+				for (size_t i = 0; i < count; ++i)
+					stdGroups[a[i]].emplace_back(i);
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					auto it = stdGroups.find(b[i]);
+
+					if (it != stdGroups.end() && !visited[it->second[0]])
+					{
+						visited[it->second[0]] = 1;
+
+						for (intptr_t ai : it->second)
+							stdCheck += ai ^ i;
+					}
+				}
+			});
+
+		// The first line of each hash and a "next same line" chain - as findUniqueLines() did
+		FlatHashMap<uint64_t, intptr_t> flatGroups;
+		std::vector<intptr_t> nextSame;
+		uint64_t flatCheck = 0;
+
+		const double flat_ms = bestRun_ms(cRuns,
+			[&]()
+			{
+				flatGroups.clear();
+				flatGroups.reserve(count);
+				nextSame.assign(count, -1);
+				visited.assign(count, 0);
+				flatCheck = 0;
+
+				// Backwards so the chains are in ascending order
+				for (size_t i = count; i-- > 0;)
+				{
+					auto insertPair = flatGroups.try_emplace(a[i], i);
+
+					if (!insertPair.second)
+					{
+						nextSame[i] = insertPair.first->second;
+						insertPair.first->second = i;
+					}
+				}
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					const auto* found = flatGroups.find(b[i]);
+
+					if (found && !visited[found->second])
+					{
+						visited[found->second] = 1;
+
+						for (intptr_t ai = found->second; ai >= 0; ai = nextSame[ai])
+							flatCheck += ai ^ i;
+					}
+				}
+			});
+
+		std::printf("    join          unordered_map<hash, vector> %8.1f ms   FlatHashMap + chain %8.1f ms   x%.2f\n",
+				std_ms, flat_ms, std_ms / flat_ms);
+
+		if (stdCheck != flatCheck)
+		{
+			std::printf("    JOIN RESULTS DIFFER\n");
+			ok = false;
+		}
+	}
+
+	// HistogramDiff's amap - the first A index per hash, looked up for every B line
+	{
+		std::unordered_map<uint64_t, intptr_t> stdMap;
+		uint64_t stdCheck = 0;
+
+		const double std_ms = bestRun_ms(cRuns,
+			[&]()
+			{
+				stdMap.clear();
+				stdMap.reserve(count);
+				stdCheck = 0;
+
+				for (size_t i = 0; i < count; ++i)
+					stdMap.try_emplace(a[i], i);
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					auto it = stdMap.find(b[i]);
+
+					if (it != stdMap.end())
+						stdCheck += it->second ^ i;
+				}
+			});
+
+		FlatHashMap<uint64_t, intptr_t> flatMap;
+		uint64_t flatCheck = 0;
+
+		const double flat_ms = bestRun_ms(cRuns,
+			[&]()
+			{
+				flatMap.clear();
+				flatMap.reserve(count);
+				flatCheck = 0;
+
+				for (size_t i = 0; i < count; ++i)
+					flatMap.try_emplace(a[i], i);
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					const auto* found = flatMap.find(b[i]);
+
+					if (found)
+						flatCheck += found->second ^ i;
+				}
+			});
+
+		std::printf("    amap          unordered_map               %8.1f ms   FlatHashMap         %8.1f ms   x%.2f\n",
+				std_ms, flat_ms, std_ms / flat_ms);
+
+		if (stdCheck != flatCheck)
+		{
+			std::printf("    AMAP RESULTS DIFFER\n");
+			ok = false;
+		}
+	}
+
+	return ok ? 0 : 1;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s line [scale]\n       %s map [scale]\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	const intptr_t scale = (argc > 2) ? std::max(1LL, std::strtoll(argv[2], nullptr, 10)) : 1;
+
+	if (!std::strcmp(argv[1], "line"))
+		return runLineBench(scale);
+
+	if (!std::strcmp(argv[1], "map"))
+		return runMapBench(scale);
+
+	std::fprintf(stderr, "Unknown benchmark '%s'\n", argv[1]);
+
+	return 2;
+}
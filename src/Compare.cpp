@@ -71,6 +71,10 @@ sptr_t			sciPtr[2];
 
 UserSettings	Settings;
 
+#ifdef MULTITHREAD
+thread_local bool	sciCallsMarshaled = false;
+#endif
+
 int gMarginWidth = 0;
 
 #ifdef DLOG
@@ -93,6 +97,7 @@ std::mutex		dLogMutex;
 
 std::string		dLog("ComparePlus debug log\n\n");
 DWORD			dLogTime_ms = 0;
+std::atomic<size_t>	dLogSciCalls {0};
 static LRESULT	dLogBuf = -1;
 
 #endif // DLOG
@@ -110,6 +115,10 @@ constexpr intptr_t SCN_MODIFIED_NOTIF_FLAGS_USED =
 	SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT | SC_MOD_BEFOREDELETE |
 	SC_PERFORMED_USER | SC_PERFORMED_UNDO | SC_PERFORMED_REDO;
 
+// Alignments with more pairs are done lazily - just around the shown lines, that many screens before and after
+constexpr intptr_t cFullAlignMaxPairs		= 50000;
+constexpr intptr_t cLazyAlignMarginScreens	= 3;
+
 
 /**
  *  \class
@@ -427,6 +436,8 @@ public:
 
 	CompareSummary	summary;
 
+	CompareState	compareState;
+
 	bool			forcedIgnoreEOL		= false;
 	bool			forcedNoManualSync	= false;
 
@@ -1632,22 +1643,13 @@ void ComparedPair::adjustAlignment(int view, intptr_t line, intptr_t offset)
 
 	const intptr_t startIdx = getAlignmentIdxAfter(alignView, alignInfo, line);
 
-	if ((startIdx < static_cast<intptr_t>(alignInfo.size())) && ((alignInfo[startIdx].*alignView).line >= line))
+	if ((startIdx < alignInfo.size()) && ((alignInfo[startIdx].*alignView).line >= line))
 	{
+		// Drop the pairs whose lines were deleted
 		if (offset < 0)
-		{
-			intptr_t endIdx = startIdx;
+			alignInfo.erase(startIdx, alignInfo.idxAfter(alignView, line - offset));
 
-			while ((endIdx < static_cast<intptr_t>(alignInfo.size())) &&
-					(line > (alignInfo[endIdx].*alignView).line + offset))
-				++endIdx;
-
-			if (endIdx > startIdx)
-				alignInfo.erase(alignInfo.begin() + startIdx, alignInfo.begin() + endIdx);
-		}
-
-		for (intptr_t i = startIdx; i < static_cast<intptr_t>(alignInfo.size()); ++i)
-			(alignInfo[i].*alignView).line += offset;
+		alignInfo.shiftLines(alignView, startIdx, offset);
 	}
 }
 
@@ -2331,18 +2333,7 @@ void syncViews(int biasView)
 intptr_t getAlignmentIdxAfter(const AlignmentViewData AlignmentPair::*pView, const AlignmentInfo_t &alignInfo,
 	intptr_t line)
 {
-	intptr_t idx = 0;
-
-	for (intptr_t i = static_cast<intptr_t>(alignInfo.size()) / 2; i; i /= 2)
-	{
-		if ((alignInfo[idx + i].*pView).line < line)
-			idx += i;
-	}
-
-	while ((idx < static_cast<intptr_t>(alignInfo.size())) && ((alignInfo[idx].*pView).line < line))
-		++idx;
-
-	return idx;
+	return alignInfo.idxAfter(pView, line);
 }
 
 
@@ -2526,7 +2517,8 @@ bool isAlignmentNeeded(int view, CompareList_t::iterator& cmpPair)
 }
 
 
-void alignDiffs(CompareList_t::iterator& cmpPair)
+// The lazy alignment window is around the given view doc line (the current view first shown line by default)
+void alignDiffs(CompareList_t::iterator& cmpPair, int view = -1, intptr_t line = -1)
 {
 	LOGD(LOG_NOTIF, "Aligning diffs\n");
 
@@ -2540,6 +2532,35 @@ void alignDiffs(CompareList_t::iterator& cmpPair)
 
 	const intptr_t maxSize = static_cast<intptr_t>(alignmentInfo.size());
 
+	// Alignment pairs [alignStart, alignEnd) are aligned
+	intptr_t alignStart	= 0;
+	intptr_t alignEnd	= maxSize;
+
+	// The first aligned pair gets the blank section that compensates all unaligned pairs above so the visible lines
+	// of both views match from there on - the scroll sync stays exact. Scrolling out of the window makes
+	// isAlignmentNeeded() true and the window is then realigned around the new location.
+	if (maxSize > cFullAlignMaxPairs)
+	{
+		if (view < 0)
+			view = getCurrentViewId();
+
+		if (line < 0)
+			line = getFirstLine(view);
+
+		const AlignmentViewData AlignmentPair::*pView =
+				(view == MAIN_VIEW) ? &AlignmentPair::main : &AlignmentPair::sub;
+
+		const intptr_t margin = CallScintilla(view, SCI_LINESONSCREEN, 0, 0) * cLazyAlignMarginScreens;
+		const intptr_t visibleLine = getVisibleFromDocLine(view, line);
+
+		alignStart	= alignmentInfo.idxAfter(pView,
+				getDocLineFromVisible(view, (visibleLine > margin) ? visibleLine - margin : 0));
+		alignEnd	= alignmentInfo.idxAfter(pView, getDocLineFromVisible(view, visibleLine + margin) + 1);
+
+		LOGD(LOG_NOTIF, "Lazy alignment of pairs " + std::to_string(alignStart) + " to " +
+				std::to_string(alignEnd) + " of " + std::to_string(maxSize) + "\n");
+	}
+
 	intptr_t mainEndLine;
 	intptr_t subEndLine;
 
@@ -2633,8 +2654,11 @@ void alignDiffs(CompareList_t::iterator& cmpPair)
 		break;
 	}
 
+	if (i < alignStart)
+		i = alignStart;
+
 	// Align all other diffs
-	for (; i < maxSize && alignmentInfo[i].main.line <= mainEndLine && alignmentInfo[i].sub.line <= subEndLine; ++i)
+	for (; i < alignEnd && alignmentInfo[i].main.line <= mainEndLine && alignmentInfo[i].sub.line <= subEndLine; ++i)
 	{
 		intptr_t previousUnhiddenLine = getPreviousUnhiddenLine(MAIN_VIEW, alignmentInfo[i].main.line);
 
@@ -2799,7 +2823,10 @@ void doAlignment(bool forceAlign = false)
 		if (!storedLocation && !goToFirst)
 			storedLocation = std::make_unique<ViewLocation>(getCurrentViewId());
 
-		alignDiffs(cmpPair);
+		if (storedLocation)
+			alignDiffs(cmpPair, storedLocation->getView(), storedLocation->getFirstLine());
+		else
+			alignDiffs(cmpPair);
 
 		delayedAlign.post(300, false);
 	}
@@ -3207,6 +3234,10 @@ bool setupCompare(CompareList_t::iterator& cmpPair, bool selectionCompare, bool
 		cmpPair->options.clearIgnoreRegex();
 
 	cmpPair->options.changedResemblPercent	= Settings.ChangedResemblPercent;
+	cmpPair->options.fastApproxDiff			= Settings.FastApproxDiff;
+	cmpPair->options.longLineLen			= Settings.LongLineLen;
+	cmpPair->options.lineDiffAlg			= (Settings.LineDiff == LINE_DIFF_PATIENCE) ? DiffAlg::PATIENCE :
+			(Settings.LineDiff == LINE_DIFF_AUTO) ? DiffAlg::AUTO : DiffAlg::MIXED;
 	cmpPair->options.selectionCompare		= selectionCompare;
 
 	cmpPair->positionFiles(recompare);
@@ -3337,7 +3368,12 @@ CompareResult runCompare(CompareList_t::iterator& cmpPair)
 	_snwprintf_s(progressInfo, _countof(progressInfo), _TRUNCATE, cmpPair->options.selectionCompare ?
 			Strings::get()["MSG_SEL_COMPARING"].c_str() : Strings::get()["MSG_COMPARING"].c_str(), newName, oldName);
 
-	return compareViews(cmpPair->options, progressInfo, cmpPair->summary);
+	// Keep the compare results only if they can be used for incremental re-compare on change
+	if (!cmpPair->options.recompareOnChange)
+		cmpPair->compareState.clear();
+
+	return compareViews(cmpPair->options, progressInfo, cmpPair->summary,
+			cmpPair->options.recompareOnChange ? &cmpPair->compareState : nullptr);
 }
 
 
@@ -3468,6 +3504,8 @@ void compare(bool selectionCompare = false, bool findUniqueMode = false, bool au
 	// Compare is triggered manually - get/re-get compare settings and position/reposition files
 	if (!autoUpdating)
 	{
+		cmpPair->compareState.clear();
+
 		if (!setupCompare(cmpPair, selectionCompare, findUniqueMode, recompare, recompareSameSelections))
 		{
 			clearComparePair(getCurrentBuffId());
@@ -4550,7 +4588,7 @@ void OpenVisualFiltersDlg()
 
 		ViewLocation loc(view, currentLine);
 
-		alignDiffs(cmpPair);
+		alignDiffs(cmpPair, view, currentLine);
 
 		loc.restore(Settings.FollowingCaret);
 
@@ -5596,6 +5634,19 @@ inline std::shared_ptr<DeletedSection::UndoData> getUndoData(int view, SCNotific
 }
 
 
+void onSciTextChanged(SCNotification* notifyCode)
+{
+	const int view = getViewIdSafe((HWND)notifyCode->nmhdr.hwndFrom);
+	if (view < 0)
+		return;
+
+	const intptr_t line = CallScintilla(view, SCI_LINEFROMPOSITION, notifyCode->position, 0);
+
+	onDocTextChanged(getDocId(view), line, notifyCode->linesAdded,
+			(notifyCode->modificationType & SC_MOD_INSERTTEXT) ? notifyCode->length : -notifyCode->length);
+}
+
+
 void onSciModified(SCNotification* notifyCode)
 {
 	static bool notReverting = true;
@@ -6177,7 +6228,11 @@ void DelayedActivate::operator()()
 		// unsaved file. We try to distinguish here the reason for the notification - if file is saved then it
 		// seems reloaded and we want to update the compare.
 		if (isCurrentFileSaved())
+		{
+			// Reloaded buffer's text is replaced without Scintilla notifications
+			dropDocLineHashes(buffId);
 			delayedRecompare.post(30);
+		}
 	}
 }
 
@@ -6470,6 +6525,10 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 
 		// This is used to monitor fold state and deletion of lines to properly clear their compare markings
 		case SCN_MODIFIED:
+			// Text changes are tracked for all docs (even if notifications are locked) to keep line hashes in sync
+			if (notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+				onSciTextChanged(notifyCode);
+
 			if (NppState::get().compareMode && !notificationsLock)
 				onSciModified(notifyCode);
 		break;
@@ -6487,6 +6546,8 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 		break;
 
 		case NPPN_FILEBEFORECLOSE:
+			dropDocLineHashes(notifyCode->nmhdr.idFrom);
+
 			if (newCompare && (newCompare->pair.file[0].buffId == static_cast<LRESULT>(notifyCode->nmhdr.idFrom)))
 				newCompare = nullptr;
 #ifdef DLOG
@@ -6503,6 +6564,9 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 		break;
 
 		case NPPN_GLOBALMODIFIED:
+			// Buffer's text was changed without Scintilla notifications
+			dropDocLineHashes(reinterpret_cast<LRESULT>(notifyCode->nmhdr.hwndFrom));
+
 			if (!compareList.empty() && !notificationsLock)
 			{
 				const LRESULT changedBuffId = reinterpret_cast<LRESULT>(notifyCode->nmhdr.hwndFrom);
@@ -6603,6 +6667,7 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 		case NPPN_SHUTDOWN:
 			Settings.save();
 			deinitPlugin();
+			stopCompareWorkers();
 		break;
 	}
 }
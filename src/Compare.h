@@ -33,6 +33,7 @@
 #ifdef DLOG
 
 	#include <string>
+	#include <atomic>
 	#include <shlwapi.h>
 
 	#include "Tools.h"
@@ -57,8 +58,9 @@
 
 #endif // MULTITHREAD
 
-	extern std::string	dLog;
-	extern DWORD		dLogTime_ms;
+	extern std::string			dLog;
+	extern DWORD				dLogTime_ms;
+	extern std::atomic<size_t>	dLogSciCalls;	// Scintilla messages sent so far (by all threads)
 
 	#define LOG_ALGO			(1 << 0)
 	#define LOG_SYNC			(1 << 1)
@@ -74,10 +76,10 @@
 
 	#define LOGD(LOG_FILTER, STR) \
 		if (DLOG & LOG_FILTER) { \
-			LOG_LOCK_GUARD \
 			const DWORD time_ms = ::GetTickCount(); \
-			wchar_t file[MAX_PATH]; \
-			::SendMessageW(nppData._nppHandle, NPPM_GETFILENAME, _countof(file), (LPARAM)file); \
+			wchar_t file[MAX_PATH] = L""; \
+			CallNpp(NPPM_GETFILENAME, _countof(file), (LPARAM)file); \
+			LOG_LOCK_GUARD \
 			std::string tmp_str { std::to_string(time_ms - dLogTime_ms) }; \
 			dLog += tmp_str; \
 			if (tmp_str.size() < 5) dLog += " ms\t\t("; \
@@ -96,10 +98,10 @@
 
 	#define LOGDB(LOG_FILTER, BUFFID, STR) \
 		if (DLOG & LOG_FILTER) { \
-			LOG_LOCK_GUARD \
 			const DWORD time_ms = ::GetTickCount(); \
-			wchar_t file[MAX_PATH]; \
-			::SendMessageW(nppData._nppHandle, NPPM_GETFULLPATHFROMBUFFERID, BUFFID, (LPARAM)file); \
+			wchar_t file[MAX_PATH] = L""; \
+			CallNpp(NPPM_GETFULLPATHFROMBUFFERID, BUFFID, (LPARAM)file); \
+			LOG_LOCK_GUARD \
 			std::string tmp_str { std::to_string(time_ms - dLogTime_ms) }; \
 			dLog += tmp_str; \
 			if (tmp_str.size() < 5) dLog += " ms\t\t("; \
@@ -187,11 +189,41 @@ extern sptr_t		sciPtr[2];
 
 extern UserSettings	Settings;
 
+#ifdef MULTITHREAD
+extern thread_local bool	sciCallsMarshaled;	// Set on the compare worker thread - see compareViews()
+
+// Has the message sent by the GUI thread and returns its result - used instead of ::SendMessageW() on the compare
+// worker thread as the messages sent to the GUI thread by other threads are refused while the compare runs
+LRESULT sendFromCompareWorker(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+#endif
+
+
+inline LRESULT CallNpp(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+#ifdef MULTITHREAD
+	if (sciCallsMarshaled)
+		return sendFromCompareWorker(nppData._nppHandle, uMsg, wParam, lParam);
+#endif
+
+	return ::SendMessageW(nppData._nppHandle, uMsg, wParam, lParam);
+}
+
 
 inline LRESULT CallScintilla(int viewNum, unsigned int uMsg, uptr_t wParam, sptr_t lParam)
 {
 	assert(viewNum >= 0 && viewNum < 2);
 
+#ifdef DLOG
+	dLogSciCalls.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+#ifdef MULTITHREAD
+	// Scintilla is not thread safe - calls from other threads are served by the GUI thread
+	if (sciCallsMarshaled)
+		return sendFromCompareWorker(viewNum ? nppData._scintillaSecondHandle : nppData._scintillaMainHandle,
+				uMsg, wParam, lParam);
+#endif
+
 	return sciFunc(sciPtr[viewNum], uMsg, wParam, lParam);
 }
 
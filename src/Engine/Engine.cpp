@@ -32,12 +32,16 @@
 #include <map>
 #include <algorithm>
 #include <functional>
+#include <string_view>
 
 #include <windows.h>
+#include <commctrl.h>
 
 #include "Tools.h"
 #include "Engine.h"
 #include "diff.h"
+#include "flat_hash_map.h"
+#include "line_hash.h"
 #include "ProgressDlg.h"
 
 
@@ -45,11 +49,7 @@
 
 #include <atomic>
 
-#if defined(__MINGW32__) && !defined(_GLIBCXX_HAS_GTHREADS)
-#include "../mingw-std-threads/mingw.thread.h"
-#else
-#include <thread>
-#endif // __MINGW32__ ...
+#include "task_pool.h"
 
 #else // MULTITHREAD not defined
 
@@ -62,6 +62,10 @@ namespace {
 
 static constexpr uint64_t cHashSeed = 0x84222325;
 
+// In long-line mode changed sections longer than that (in bytes) are not compared by chars and the lines are widened
+// and split to words in windows of that size
+static constexpr intptr_t cLongLineCharWindow = 1024;
+
 
 enum class charType
 {
@@ -80,6 +84,10 @@ struct Line : public hash_type<uint64_t>
 };
 
 
+// Compared line's class ID - equal lines (same hash) in both docs get the same dense ID (see internLines())
+using LineId = dense_id_type<uint32_t>;
+
+
 // Compared element 'Word'
 struct Word : public hash_type<uint64_t>
 {
@@ -181,12 +189,31 @@ struct DocCmpInfo
 
 	const range_t	diff_info::*diffPtr;
 
-	std::vector<Line>				lines; // Compared lines from 'range' member (vector's index is not a doc line!)
-	std::unordered_set<intptr_t>	nonUniqueDocLines;
+	std::vector<Line>		lines;			// Compared lines from 'range' member (vector's index is not a doc line!)
+	std::vector<LineId>		lineIds;		// Compared lines class IDs (same index as in 'lines')
+	uint64_t				linesFingerprint {0};	// Combined hash of the compared lines' hashes (in order)
+	std::vector<uint32_t>	classCount;		// Lines count per class ID
+	std::vector<bool>		nonUniqueLines;	// Compared lines that are present in the other doc too
 
 	std::vector<std::vector<ChangedLine>>	changedLines;	// Changed lines per block diff (sub-block compare)
 	std::vector<MovedRanges>				movedRanges;	// Moved lines ranges per block diff
 
+	// Doc as seen when its lines were taken - 'changedDocLines' are the lines changed since the kept line hashes'
+	// previous use ('hashesPrevUse', 0 if the hashes were not kept or reset - all lines are taken as changed then)
+	intptr_t	docLen {0};
+	intptr_t	docLinesCount {0};
+	range_t		changedDocLines;
+	unsigned	hashesPrevUse {0};
+	unsigned	hashesUse {0};
+
+	// Doc text and lines positions (EOLs excluded) per changed block diff - the sub-block compare reads the text
+	// directly as it can run in several threads (Scintilla must be called only from the main thread)
+	const char*							text {nullptr};
+	int									codepage {0};
+	std::vector<std::vector<range_t>>	linesPos;
+
+	ViewMarks	marks;
+
 	inline const range_t& diffRange(const diff_info& di) const
 	{
 		return (di.*diffPtr);
@@ -225,6 +252,21 @@ struct DocCmpInfo
 
 		return lines[diffRange(di).s + off].num;
 	}
+
+	inline bool isNonUnique(intptr_t idx) const
+	{
+		return (static_cast<size_t>(idx) < nonUniqueLines.size() && nonUniqueLines[idx]);
+	}
+
+	inline std::string_view getLineText(intptr_t diffIdx, intptr_t lineIdx) const
+	{
+		assert(static_cast<size_t>(diffIdx) < linesPos.size() &&
+				lineIdx >= 0 && static_cast<size_t>(lineIdx) < linesPos[diffIdx].size());
+
+		const range_t& pos = linesPos[diffIdx][lineIdx];
+
+		return std::string_view(text + pos.s, static_cast<size_t>(pos.len()));
+	}
 };
 
 
@@ -255,22 +297,192 @@ struct ChangedLinesInfo
 };
 
 
-template<typename CharT>
-inline uint64_t Hash(uint64_t hval, CharT letter)
+// Per doc line info kept with the line text hash
+enum LineInfo : uint8_t
+{
+	LINE_CHANGED	= 0,		// Line needs (re-)hashing
+	LINE_HASHED		= 1 << 0,
+	LINE_NO_TEXT	= 1 << 1,	// Line is empty or has only EOL
+	LINE_EOL_SHIFT	= 2			// Line's EOL type (index in cEOLs) is kept in the bits starting from this one
+};
+
+
+// All Scintilla line ends - the Unicode ones are used only if enabled for the doc
+constexpr std::string_view cEOLs[] = { "", "\n", "\r", "\r\n", "\xC2\x85", "\xE2\x80\xA8", "\xE2\x80\xA9" };
+
+
+// Spaces and case ignore options change the hashed line text - a separate line hashes variant is kept for each
+// combination. EOL and empty lines ignore options are applied on top of the variant's line text hashes.
+constexpr int cLineHashVariants = 6;
+
+
+// Document line hashes kept between compares
+struct DocLineHashes
+{
+	LRESULT		buffId {0};
+	intptr_t	docLen {0};			// Expected doc length - if it differs some change was not notified
+	intptr_t	linesCount {-1};
+	int			codepage {0};
+	bool		defaultEOLs {true};
+	unsigned	lastUse {0};
+
+	// Per doc line text hashes and LineInfo for each variant (empty if the variant was not needed yet)
+	std::vector<uint64_t>	hashes[cLineHashVariants];
+	std::vector<uint8_t>	info[cLineHashVariants];
+};
+
+
+// Compared document text as accessed directly in Scintilla's buffer
+struct DocText
+{
+	int			view {0};
+	int			codepage {0};
+	bool		defaultEOLs {true};	// Only CR, LF and CRLF line ends - lines can be scanned without Scintilla's help
+	intptr_t	startPos {0};		// Doc position of 'text' start
+	const char*	text {nullptr};
+
+	// Per doc line text hashes and LineInfo kept between compares (nullptr if not kept)
+	uint64_t*	lineHashes {nullptr};
+	uint8_t*	lineInfo {nullptr};
+};
+
+
+// Line-aligned part of the compared range that is hashed independently of the other parts
+struct LinesChunk
+{
+	LinesChunk(const DocText& dt, intptr_t startLine, intptr_t endLine) : docText(dt), docLines(startLine, endLine) {}
+
+	const DocText&	docText;
+	range_t			docLines;
+	const char*		text {nullptr};
+	const char*		textEnd {nullptr};
+
+	std::vector<Line>		lines;
+	std::vector<range_t>	regexIgnores;	// Doc text ranges to be highlighted as regex ignored
+};
+
+
+// Kept line hashes per Scintilla document
+std::unordered_map<intptr_t, DocLineHashes> docsLineHashes;
+
+unsigned docsLineHashesUseCount = 0;
+
+#ifdef MULTITHREAD
+// Held by the compare while it uses the kept line hashes. The GUI thread never waits for it as the compare worker
+// might be waiting for the GUI thread to serve its Scintilla calls - the cache is marked stale instead and dropped
+// on next use.
+std::mutex docsLineHashesMutex;
+std::atomic<bool> docsLineHashesStale {false};
+
+// Counts the docs text changes (GUI thread only) - the compare results are dropped if a doc changed meanwhile
+size_t docsTextChanges = 0;
+#endif
+
+
+inline int getLineHashVariant(const CompareOptions& options)
+{
+	return (options.ignoreAllSpaces ? 2 : options.ignoreChangedSpaces ? 1 : 0) + (options.ignoreCase ? 3 : 0);
+}
+
+
+inline uint8_t getEOLType(const char* eol, const char* end)
+{
+	const std::string_view eolStr(eol, end - eol);
+
+	for (uint8_t type = 1; type < std::size(cEOLs); ++type)
+	{
+		if (eolStr == cEOLs[type])
+			return type;
+	}
+
+	return 0;
+}
+
+
+// Gets the compared line hash out of its text hash applying the EOL and empty lines ignore options
+// Returns false if the line is not compared
+inline bool getComparedLineHash(uint64_t textHash, uint8_t info, const CompareOptions& options, uint64_t& hash)
+{
+	const uint8_t eolType = info >> LINE_EOL_SHIFT;
+
+	hash = textHash;
+
+	if (eolType && !options.ignoreEOL)
+	{
+		LineHasher hasher(textHash);
+
+		hasher.update(cEOLs[eolType].data(), cEOLs[eolType].size());
+		hash = hasher.digest();
+	}
+
+	if (options.ignoreEmptyLines)
+		return (!(info & LINE_NO_TEXT) && hash != cHashSeed);
+
+	return true;
+}
+
+
+// Gets the kept line hashes of the doc for the options' variant resetting them if they cannot be reused.
+// Returns the hashes' previous use stamp (0 if they were just reset or created).
+unsigned getDocLineHashes(DocText& docText, intptr_t docLen, intptr_t linesCount, const CompareOptions& options)
 {
-	hval ^= static_cast<uint64_t>(letter);
+	// Limits the memory kept for docs that are not compared anymore
+	constexpr size_t cMaxDocs = 16;
+
+	const intptr_t sciDoc = getDocId(docText.view);
+
+	if (docsLineHashes.size() >= cMaxDocs && docsLineHashes.find(sciDoc) == docsLineHashes.end())
+	{
+		docsLineHashes.erase(std::min_element(docsLineHashes.begin(), docsLineHashes.end(),
+				[](const auto& lhs, const auto& rhs) { return lhs.second.lastUse < rhs.second.lastUse; }));
+	}
+
+	DocLineHashes& dlh = docsLineHashes[sciDoc];
+
+	unsigned prevUse = dlh.lastUse;
+
+	if ((dlh.docLen != docLen) || (dlh.linesCount != linesCount) ||
+		(dlh.codepage != docText.codepage) || (dlh.defaultEOLs != docText.defaultEOLs))
+	{
+		LOGD(LOG_ALGO, "Kept line hashes of view " + std::to_string(docText.view) + " reset\n");
+
+		dlh.docLen		= docLen;
+		dlh.linesCount	= linesCount;
+		dlh.codepage	= docText.codepage;
+		dlh.defaultEOLs	= docText.defaultEOLs;
+
+		for (int i = 0; i < cLineHashVariants; ++i)
+		{
+			dlh.hashes[i].clear();
+			dlh.info[i].clear();
+		}
+	}
+
+	const int variant = getLineHashVariant(options);
 
-	hval += (hval << 1) + (hval << 4) + (hval << 5) + (hval << 7) + (hval << 8) + (hval << 40);
+	if (dlh.info[variant].empty())
+	{
+		dlh.hashes[variant].assign(linesCount, 0);
+		dlh.info[variant].assign(linesCount, LINE_CHANGED);
+
+		prevUse = 0;
+	}
+
+	dlh.buffId	= getCurrentBuffId(docText.view);
+	dlh.lastUse	= ++docsLineHashesUseCount;
 
-	return hval;
+	docText.lineHashes	= dlh.hashes[variant].data();
+	docText.lineInfo	= dlh.info[variant].data();
+
+	return prevUse;
 }
 
 
-inline uint64_t getSectionRangeHash(uint64_t hashSeed, std::vector<wchar_t>& sec, intptr_t pos, intptr_t endPos,
+inline void hashSection(LineHasher& hasher, std::vector<wchar_t>& sec, intptr_t pos, intptr_t endPos,
 		const CompareOptions& options)
 {
 	if (pos >= endPos)
-		return hashSeed;
+		return;
 
 	if (options.ignoreCase)
 	{
@@ -283,41 +495,86 @@ inline uint64_t getSectionRangeHash(uint64_t hashSeed, std::vector<wchar_t>& sec
 		sec[endPos] = storedChar;
 	}
 
-	for (; pos < endPos; ++pos)
+	if (options.ignoreAllSpaces)
+		hasher.updateIgnoreSpaces(sec.data() + pos, endPos - pos);
+	else if (options.ignoreChangedSpaces)
+		hasher.updateCollapseSpaces(sec.data() + pos, endPos - pos, false);
+	else
+		hasher.update(sec.data() + pos, endPos - pos);
+}
+
+
+// Lower-cases the text to 'out' folding ASCII directly - only non-ASCII chars are converted to wide chars and back
+void getLowerCaseText(std::vector<char>& out, std::vector<wchar_t>& wideBuf, const char* text, size_t len,
+	int codepage)
+{
+	out.resize(len);
+
+	size_t pos = toLowerASCII(text, len, out.data());
+
+	if (pos == len)
+		return;
+
+	// DBCS trail bytes can be in the ASCII range - fold the whole text at once in that case
+	if (codepage != CP_UTF8)
 	{
-		if (options.ignoreAllSpaces && (sec[pos] == L' ' || sec[pos] == L'\t'))
-			continue;
+		out.assign(text, text + len);
+		toLowerCase(out, codepage);
 
-		if (options.ignoreChangedSpaces && (sec[pos] == L' ' || sec[pos] == L'\t'))
-		{
-			hashSeed = Hash(hashSeed, L' ');
+		return;
+	}
 
-			while (++pos < endPos && (sec[pos] == L' ' || sec[pos] == L'\t'));
+	size_t outPos = pos;
 
-			if (pos == endPos)
-				return hashSeed;
-		}
+	// UTF-8 multi-byte sequences never contain ASCII bytes so non-ASCII runs can be folded separately
+	while (pos < len)
+	{
+		size_t runEnd = pos;
+
+		while (++runEnd < len && (text[runEnd] & 0x80));
+
+		const int runLen = static_cast<int>(runEnd - pos);
+		const int wLen = ::MultiByteToWideChar(CP_UTF8, 0, text + pos, runLen, NULL, 0);
+
+		wideBuf.resize(wLen);
+
+		::MultiByteToWideChar(CP_UTF8, 0, text + pos, runLen, wideBuf.data(), wLen);
+		::CharLowerBuffW(wideBuf.data(), wLen);
+
+		const int mbLen = ::WideCharToMultiByte(CP_UTF8, 0, wideBuf.data(), wLen, NULL, 0, NULL, NULL);
+
+		// Folded chars might differ in length
+		out.resize(outPos + mbLen + (len - runEnd));
+
+		::WideCharToMultiByte(CP_UTF8, 0, wideBuf.data(), wLen, out.data() + outPos, mbLen, NULL, NULL);
+
+		outPos += mbLen;
+
+		const size_t asciiLen = toLowerASCII(text + runEnd, len - runEnd, out.data() + outPos);
 
-		hashSeed = Hash(hashSeed, sec[pos]);
+		outPos += asciiLen;
+		pos = runEnd + asciiLen;
 	}
 
-	return hashSeed;
+	out.resize(outPos);
 }
 
 
-uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int codepage, const std::vector<char>& line,
-	const CompareOptions& options)
+// Regex ignored text ranges to be highlighted are collected in 'regexIgnores' (if enabled) - the function is thread-safe
+uint64_t getRegexIgnoreLineHash(std::vector<range_t>& regexIgnores, intptr_t off, uint64_t hashSeed, int codepage,
+	const char* line, int len, const CompareOptions& options)
 {
-	const int len = static_cast<int>(line.size());
+	LineHasher hasher(hashSeed);
 
 	if (len == 0)
-		return hashSeed;
+		return hasher.digest();
 
-	const int wLen = ::MultiByteToWideChar(codepage, 0, line.data(), len, NULL, 0);
+	// Leave room for terminating null - the line is not null-terminated as it points directly to the doc buffer
+	const int wLen = ::MultiByteToWideChar(codepage, 0, line, len, NULL, 0) + 1;
 
-	std::vector<wchar_t> wLine(wLen);
+	std::vector<wchar_t> wLine(wLen, L'\0');
 
-	::MultiByteToWideChar(codepage, 0, line.data(), len, wLine.data(), wLen);
+	::MultiByteToWideChar(codepage, 0, line, len, wLine.data(), wLen - 1);
 
 #ifndef MULTITHREAD
 	LOGD(LOG_ALGO, "line len " + std::to_string(len) + " to wide char len " + std::to_string(wLen) + "\n");
@@ -337,14 +594,15 @@ uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int c
 #ifndef MULTITHREAD
 			LOGD(LOG_ALGO, "pos " + std::to_string(rit->position()) + ", len " + std::to_string(rit->length()) + "\n");
 #endif
-			hashSeed = getSectionRangeHash(hashSeed, wLine, rit->position(), rit->position() + rit->length(), options);
+			hashSection(hasher, wLine, rit->position(), rit->position() + rit->length(), options);
 
 			if (options.highlightRegexIgnores)
 			{
 				const int mbLen = ::WideCharToMultiByte(codepage, 0,
 						wLine.data() + pos, static_cast<int>(rit->position() - pos), NULL, 0, NULL, NULL);
 
-				markTextAsChanged(view, off + mbPos, mbLen, Settings.colors().blank);
+				if (mbLen > 0)
+					regexIgnores.emplace_back(off + mbPos, off + mbPos + mbLen);
 
 				pos = rit->position() + rit->length();
 				mbPos += mbLen + ::WideCharToMultiByte(codepage, 0,
@@ -352,8 +610,8 @@ uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int c
 			}
 		}
 
-		if (options.highlightRegexIgnores)
-			markTextAsChanged(view, off + mbPos, len - 1 - mbPos, Settings.colors().blank);
+		if (options.highlightRegexIgnores && len > mbPos)
+			regexIgnores.emplace_back(off + mbPos, off + len);
 	}
 	else
 	{
@@ -366,7 +624,7 @@ uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int c
 			while (++pos < endPos && (wLine[pos] == L' ' || wLine[pos] == L'\t'));
 
 			if (pos == endPos)
-				return hashSeed;
+				return hasher.digest();
 		}
 
 		while (rit != rend)
@@ -374,7 +632,7 @@ uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int c
 #ifndef MULTITHREAD
 			LOGD(LOG_ALGO, "pos " + std::to_string(rit->position()) + ", len " + std::to_string(rit->length()) + "\n");
 #endif
-			hashSeed = getSectionRangeHash(hashSeed, wLine, pos, rit->position(), options);
+			hashSection(hasher, wLine, pos, rit->position(), options);
 
 			if (options.highlightRegexIgnores)
 			{
@@ -383,7 +641,8 @@ uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int c
 				const int mbLen = ::WideCharToMultiByte(codepage, 0,
 						wLine.data() + rit->position(), static_cast<int>(rit->length()), NULL, 0, NULL, NULL);
 
-				markTextAsChanged(view, off + mbPos, mbLen, Settings.colors().blank);
+				if (mbLen > 0)
+					regexIgnores.emplace_back(off + mbPos, off + mbPos + mbLen);
 
 				mbPos += mbLen;
 			}
@@ -403,211 +662,422 @@ uint64_t getRegexIgnoreLineHash(int view, intptr_t off, uint64_t hashSeed, int c
 				while (--p >= pos && (wLine[p] == L' ' || wLine[p] == L'\t'));
 
 				if (++p > pos)
-					hashSeed = getSectionRangeHash(hashSeed, wLine, pos, p, options);
+					hashSection(hasher, wLine, pos, p, options);
 			}
 
-			hashSeed = getSectionRangeHash(hashSeed, wLine, eolPos, endPos, options);
+			hashSection(hasher, wLine, eolPos, endPos, options);
 		}
 		else
 		{
-			hashSeed = getSectionRangeHash(hashSeed, wLine, pos, endPos, options);
+			hashSection(hasher, wLine, pos, endPos, options);
 		}
 	}
 
-	return hashSeed;
+	return hasher.digest();
 }
 
 
-void getLines(DocCmpInfo& doc, const CompareOptions& options)
+// Splits the compared range of 'doc' into line chunks skipping the ignored (folded / hidden) lines
+void getLinesChunks(DocCmpInfo& doc, const CompareOptions& options, DocText& docText, std::vector<LinesChunk>& chunks,
+	unsigned chunksPerDoc)
 {
-	constexpr int monitorCancelEveryXLine = 10000;
-
-	progress_ptr& progress = ProgressDlg::Get();
+	// Makes the threading overhead per chunk negligible
+	constexpr intptr_t cMinChunkLines = 8192;
 
 	doc.lines.clear();
 
-	if (!CallScintilla(doc.view, SCI_GETLENGTH, 0, 0))
-		return;
+	const intptr_t docLen = CallScintilla(doc.view, SCI_GETLENGTH, 0, 0);
 
 	intptr_t linesCount = getLinesCount(doc.view);
 
+	docText.view		= doc.view;
+	docText.codepage	= getCodepage(doc.view);
+	docText.defaultEOLs	= (CallScintilla(doc.view, SCI_GETLINEENDTYPESACTIVE, 0, 0) == SC_LINE_END_TYPE_DEFAULT);
+
+	doc.docLen			= docLen;
+	doc.docLinesCount	= linesCount;
+	doc.changedDocLines	= range_t(0, linesCount);
+	doc.hashesPrevUse	= 0;
+
+	// Regex ignored parts are highlighted while hashing so lines are always re-hashed in that case
+	if (!options.ignoreRegex)
+	{
+		doc.hashesPrevUse	= getDocLineHashes(docText, docLen, linesCount, options);
+		doc.hashesUse		= docsLineHashesUseCount;
+
+		// Folding changes which lines are compared without changing any line
+		if (doc.hashesPrevUse && !options.ignoreFoldedLines && !options.ignoreHiddenLines)
+		{
+			const uint8_t* const info = docText.lineInfo;
+
+			const intptr_t firstChanged = std::find(info, info + linesCount, LINE_CHANGED) - info;
+			intptr_t endChanged = linesCount;
+
+			while (endChanged > firstChanged && info[endChanged - 1] != LINE_CHANGED)
+				--endChanged;
+
+			doc.changedDocLines = range_t(firstChanged, endChanged);
+		}
+		else
+		{
+			doc.hashesPrevUse = 0;
+		}
+	}
+
+	if (!docLen)
+		return;
+
 	if (isLineEmpty(doc.view, linesCount - 1))
+	{
 		--linesCount;
 
+		// The last empty line is never compared - kept as hashed it is not taken as changed on next compare
+		if (docText.lineInfo)
+		{
+			docText.lineHashes[linesCount]	= LineHasher(cHashSeed).digest();
+			docText.lineInfo[linesCount]	= LINE_HASHED | LINE_NO_TEXT;
+		}
+	}
+
 	if ((doc.range.len() <= 0) || (doc.range.e > linesCount))
 		doc.range.e = linesCount;
 
-	progress->SetMaxCount((doc.range.len() / monitorCancelEveryXLine) + 1);
+	docText.startPos	= getLineStart(doc.view, doc.range.s);
+	docText.text		= getRangePointer(doc.view, docText.startPos, getLineStart(doc.view, doc.range.e));
 
-	doc.lines.reserve(doc.range.len());
+	const intptr_t chunkLinesCount = std::max(cMinChunkLines,
+			(doc.range.len() + static_cast<intptr_t>(chunksPerDoc) - 1) / static_cast<intptr_t>(chunksPerDoc));
 
-	int cancelCheckCount = monitorCancelEveryXLine;
+	auto addChunks =
+		[&](intptr_t startLine, intptr_t endLine)
+		{
+			for (; startLine < endLine; startLine += chunkLinesCount)
+			{
+				LinesChunk& chunk = chunks.emplace_back(docText, startLine, std::min(startLine + chunkLinesCount, endLine));
+
+				chunk.text		= docText.text + (getLineStart(doc.view, chunk.docLines.s) - docText.startPos);
+				chunk.textEnd	= docText.text + (getLineStart(doc.view, chunk.docLines.e) - docText.startPos);
+			}
+		};
 
-	// Group ignore options to speed-up per-line checks
 	const bool checkForIgnoredLines = !CallScintilla(doc.view, SCI_GETALLLINESVISIBLE, 0, 0) &&
 		(options.ignoreFoldedLines || options.ignoreHiddenLines);
-	const bool inclEmptyLinesAndEOL = !options.ignoreEOL && !options.ignoreEmptyLines;
+
+	if (!checkForIgnoredLines)
+	{
+		addChunks(doc.range.s, doc.range.e);
+		return;
+	}
+
+	intptr_t startLine = doc.range.s;
+
+	for (intptr_t docLine = doc.range.s; docLine < doc.range.e; ++docLine)
+	{
+		intptr_t nextLine = docLine;
+
+		if (!options.ignoreFoldedLines || !getNextLineAfterFold(doc.view, &nextLine))
+		{
+			if (!options.ignoreHiddenLines || !isLineHidden(doc.view, docLine) || isLineFolded(doc.view, docLine))
+				continue;
+
+			nextLine = getUnhiddenLine(doc.view, docLine);
+		}
+
+		addChunks(startLine, docLine);
+
+		startLine = nextLine;
+		docLine = nextLine - 1;
+	}
+
+	addChunks(startLine, doc.range.e);
+}
+
+
+// Thread-safe as long as the doc has default EOLs (otherwise Scintilla is queried for line positions)
+void getChunkLines(LinesChunk& chunk, const CompareOptions& options)
+{
+	constexpr int monitorCancelEveryXLine = 10000;
+
+	const progress_ptr& progress = ProgressDlg::Get();
+	const DocText& doc = chunk.docText;
+
+	chunk.lines.reserve(chunk.docLines.len());
+
+	int cancelCheckCount = monitorCancelEveryXLine;
+
+	// Group regex ignore options to speed-up per-line checks
 	const bool inclEmptyLines =
 		!options.ignoreEmptyLines && (!options.ignoreRegex || !options.invertRegex || options.inclRegexNomatchLines);
 	const bool inclRegexEmptyLines =
 		!options.ignoreEmptyLines && options.ignoreRegex && options.invertRegex && options.inclRegexNomatchLines;
 
-	const int codepage = getCodepage(doc.view);
+	uint64_t* const lineHashes = doc.lineHashes;
+	uint8_t* const lineInfo = doc.lineInfo;
 
-	for (intptr_t l = 0; l < doc.range.len(); ++l)
-	{
-		if (!(--cancelCheckCount))
+	auto addLine =
+		[&](intptr_t docLine, uint64_t textHash, uint8_t info)
 		{
-			progress->Advance();
-			cancelCheckCount = monitorCancelEveryXLine;
-		}
+			uint64_t hash;
 
-		intptr_t docLine = l + doc.range.s;
+			if (getComparedLineHash(textHash, info, options, hash))
+				chunk.lines.emplace_back(docLine, hash);
+		};
 
-		if (checkForIgnoredLines)
-		{
-			if (options.ignoreFoldedLines && getNextLineAfterFold(doc.view, &docLine))
-			{
-				l = --docLine - doc.range.s;
-				continue;
-			}
+	// Nothing changed in the chunk since the last compare - no need to even scan its text
+	if (lineInfo && std::find(lineInfo + chunk.docLines.s, lineInfo + chunk.docLines.e,
+			LINE_CHANGED) == lineInfo + chunk.docLines.e)
+	{
+		for (intptr_t docLine = chunk.docLines.s; docLine < chunk.docLines.e; ++docLine)
+			addLine(docLine, lineHashes[docLine], lineInfo[docLine]);
 
-			if (options.ignoreHiddenLines && isLineHidden(doc.view, docLine) && !isLineFolded(doc.view, docLine))
-			{
-				docLine = getUnhiddenLine(doc.view, docLine);
-				l = --docLine - doc.range.s;
-				continue;
-			}
+		return;
+	}
+
+	std::vector<char> lowerCaseLine;
+	std::vector<wchar_t> wideBuf;
+
+	const char* lineStart = chunk.text;
+	const char* nextLineStart = chunk.text;
+
+	for (intptr_t docLine = chunk.docLines.s; docLine < chunk.docLines.e; ++docLine, lineStart = nextLineStart)
+	{
+		if (!(--cancelCheckCount))
+		{
+			progress->ThrowIfCancelled();
+			cancelCheckCount = monitorCancelEveryXLine;
 		}
 
-		const intptr_t lineStart	= getLineStart(doc.view, docLine);
-		const intptr_t lineEndNoEOL	= getLineEnd(doc.view, docLine);
-		intptr_t lineEnd;
+		const char* lineEndNoEOL;
 
-		if (inclEmptyLinesAndEOL)
+		if (doc.defaultEOLs)
 		{
-			lineEnd = lineStart + CallScintilla(doc.view, SCI_LINELENGTH, docLine, 0);
+			lineEndNoEOL	= findEOL(lineStart, chunk.textEnd);
+			nextLineStart	= skipEOL(lineEndNoEOL, chunk.textEnd);
 		}
 		else
 		{
-			lineEnd = lineEndNoEOL;
-
-			// Because of the parent 'if' that check actually means that empty lines are ignored
-			if (!options.ignoreEOL)
-			{
-				if (lineStart == lineEnd)
-					continue;
-				else
-					lineEnd = lineStart + CallScintilla(doc.view, SCI_LINELENGTH, docLine, 0);
-			}
+			lineEndNoEOL	= doc.text + (getLineEnd(doc.view, docLine) - doc.startPos);
+			nextLineStart	= lineStart + CallScintilla(doc.view, SCI_LINELENGTH, docLine, 0);
 		}
 
-		Line newLine {docLine, cHashSeed};
+		if (lineInfo && lineInfo[docLine] != LINE_CHANGED)
+		{
+			addLine(docLine, lineHashes[docLine], lineInfo[docLine]);
+			continue;
+		}
 
-		if (lineStart < lineEnd)
+		if (options.ignoreRegex)
 		{
-			std::vector<char> line = getText(doc.view, lineStart, lineEnd);
+			// Empty lines are skipped here only if ignored together with their EOLs
+			if (options.ignoreEmptyLines && !options.ignoreEOL && (lineStart == lineEndNoEOL))
+				continue;
 
-			if (options.ignoreRegex)
+			const char* lineEnd = options.ignoreEOL ? lineEndNoEOL : nextLineStart;
+
+			if (lineStart < lineEnd)
 			{
 #ifndef MULTITHREAD
 				LOGD(LOG_ALGO, "Regex Ignore on line " + std::to_string(docLine + 1) +
 						", view " + std::to_string(doc.view) + "\n");
 #endif
-				newLine.hash = getRegexIgnoreLineHash(doc.view, lineStart, newLine.hash, codepage, line, options);
+				const uint64_t hash = getRegexIgnoreLineHash(chunk.regexIgnores,
+						doc.startPos + (lineStart - doc.text), cHashSeed, doc.codepage,
+						lineStart, static_cast<int>(lineEnd - lineStart), options);
 
-				if (newLine.hash != cHashSeed || inclRegexEmptyLines)
-					doc.lines.emplace_back(newLine);
+				if (hash != cHashSeed || inclRegexEmptyLines)
+					chunk.lines.emplace_back(docLine, hash);
 			}
-			else
+			else if (inclEmptyLines)
 			{
-				if (options.ignoreCase)
-					toLowerCase(line, codepage);
-
-				intptr_t pos = 0;
-				intptr_t endPos = lineEndNoEOL - lineStart;
-
-				if (options.ignoreChangedSpaces)
-				{
-					while (pos < endPos && (line[pos] == ' ' || line[pos] == '\t'))
-						++pos;
-
-					while (--endPos >= pos && (line[endPos] == ' ' || line[endPos] == '\t'));
-
-					++endPos;
-				}
-
-				for (; pos < endPos; ++pos)
-				{
-					if (options.ignoreAllSpaces && (line[pos] == ' ' || line[pos] == '\t'))
-						continue;
-
-					if (options.ignoreChangedSpaces && (line[pos] == ' ' || line[pos] == '\t'))
-					{
-						newLine.hash = Hash(newLine.hash, ' ');
+				chunk.lines.emplace_back(docLine, cHashSeed);
+			}
 
-						while (++pos < endPos && (line[pos] == ' ' || line[pos] == '\t'));
+			continue;
+		}
 
-						if (pos == endPos)
-							break;
-					}
+		LineHasher hasher(cHashSeed);
 
-					newLine.hash = Hash(newLine.hash, line[pos]);
-				}
+		if (lineStart < lineEndNoEOL)
+		{
+			const char* line = lineStart;
+			size_t len = lineEndNoEOL - lineStart;
 
-				if (lineEnd > lineEndNoEOL)
-				{
-					endPos = lineEnd - lineStart;
+			if (options.ignoreCase)
+			{
+				getLowerCaseText(lowerCaseLine, wideBuf, line, len, doc.codepage);
+				line = lowerCaseLine.data();
+				len = lowerCaseLine.size();
+			}
 
-					if ((options.ignoreAllSpaces || options.ignoreChangedSpaces) &&
-							(line[pos] == ' ' || line[pos] == '\t'))
-						while (++pos < endPos && (line[pos] == ' ' || line[pos] == '\t'));
+			if (options.ignoreAllSpaces)
+				hasher.updateIgnoreSpaces(line, len);
+			else if (options.ignoreChangedSpaces)
+				hasher.updateCollapseSpaces(line, len, true);
+			else
+				hasher.update(line, len);
+		}
 
-					for (; pos < endPos; ++pos)
-						newLine.hash = Hash(newLine.hash, line[pos]);
-				}
+		const uint64_t textHash = hasher.digest();
+		const uint8_t info = LINE_HASHED | ((lineStart == lineEndNoEOL) ? LINE_NO_TEXT : 0) |
+				(getEOLType(lineEndNoEOL, nextLineStart) << LINE_EOL_SHIFT);
 
-				if (newLine.hash != cHashSeed || !options.ignoreEmptyLines)
-					doc.lines.emplace_back(newLine);
-			}
-		}
-		else if (inclEmptyLines)
+		if (lineInfo)
 		{
-			doc.lines.emplace_back(newLine);
+			lineHashes[docLine]	= textHash;
+			lineInfo[docLine]	= info;
 		}
+
+		addLine(docLine, textHash, info);
 	}
 }
 
 
-inline charType getCharTypeW(wchar_t letter)
+// Gets the compared lines of both documents at once - the line hashing is done in parallel on line chunks
+void getLines(DocCmpInfo& a, DocCmpInfo& b, const CompareOptions& options)
 {
-	if (letter == L' ' || letter == L'\t')
-		return charType::SPACECHAR;
+	progress_ptr& progress = ProgressDlg::Get();
 
-	if (::IsCharAlphaNumericW(letter) || letter == L'_')
-		return charType::ALPHANUMCHAR;
+#ifdef DLOG
+	const DWORD startTime_ms = ::GetTickCount();
+#endif
 
-	return charType::OTHERCHAR;
-}
+	unsigned threadsCount = 1;
+
+#ifdef MULTITHREAD
+	threadsCount = TaskPool::Get().threadsCount();
+#endif
 
+	DocText aText;
+	DocText bText;
 
-inline void recalculateWordPos(int codepage, std::vector<Word>& words, const std::vector<wchar_t>& line)
-{
-	intptr_t bytePos = 0;
-	intptr_t currPos = 0;
+#ifdef MULTITHREAD
+	std::lock_guard<std::mutex> hashesLock(docsLineHashesMutex);
 
-	for (auto& word : words)
+	if (docsLineHashesStale.exchange(false))
 	{
-		if (currPos < word.pos)
-			bytePos += ::WideCharToMultiByte(codepage, 0, line.data() + currPos, static_cast<int>(word.pos - currPos),
-					NULL, 0, NULL, NULL);
+		LOGD(LOG_ALGO, "Kept line hashes changed while in use - all dropped\n");
 
-		currPos = word.pos + word.len;
-		word.len = ::WideCharToMultiByte(codepage, 0, line.data() + word.pos, static_cast<int>(word.len),
-				NULL, 0, NULL, NULL);
-		word.pos = bytePos;
-		bytePos += word.len;
+		docsLineHashes.clear();
 	}
+#endif
+
+	std::vector<LinesChunk> chunks;
+
+	// Several chunks per thread to balance the load in case some parts of the docs are much cheaper to hash
+	getLinesChunks(a, options, aText, chunks, threadsCount * 2);
+
+	const size_t aChunksCount = chunks.size();
+
+	getLinesChunks(b, options, bText, chunks, threadsCount * 2);
+
+	progress->SetMaxCount(static_cast<intptr_t>(chunks.size()));
+
+#ifdef MULTITHREAD
+	// Scintilla is queried on each line if there are Unicode line ends - process the chunks in this thread then
+	if (threadsCount > 1 && chunks.size() > 1 && aText.defaultEOLs && bText.defaultEOLs)
+	{
+		threadsCount = std::min(threadsCount, static_cast<unsigned>(chunks.size()));
+
+		std::atomic<intptr_t> chunksDone {0};
+
+		TaskPool::Get().run(chunks.size(),
+			[&](size_t i, unsigned slot)
+			{
+				getChunkLines(chunks[i], options);
+
+				++chunksDone;
+
+				// Progress updates are not thread-safe - leave them to the calling thread only
+				if (slot == 0)
+					progress->SetCount(chunksDone);
+			},
+			std::bind(&ProgressDlg::ThrowIfCancelled, progress));
+	}
+	else
+#endif // MULTITHREAD
+	{
+		threadsCount = 1;
+
+		for (auto& chunk : chunks)
+		{
+			getChunkLines(chunk, options);
+
+			progress->Advance();
+		}
+	}
+
+	// Stitch chunks' lines back in order
+	auto collectLines =
+		[&](DocCmpInfo& doc, size_t startChunk, size_t endChunk)
+		{
+			size_t linesCount = 0;
+
+			for (size_t i = startChunk; i < endChunk; ++i)
+				linesCount += chunks[i].lines.size();
+
+			doc.lines.reserve(linesCount);
+
+			for (size_t i = startChunk; i < endChunk; ++i)
+			{
+				doc.lines.insert(doc.lines.end(), chunks[i].lines.begin(), chunks[i].lines.end());
+
+				for (const auto& r : chunks[i].regexIgnores)
+					doc.marks.text.push_back({r.s, r.len(), Settings.colors().blank});
+			}
+		};
+
+	collectLines(a, 0, aChunksCount);
+	collectLines(b, aChunksCount, chunks.size());
+
+	LOGD(LOG_ALGO, "Lines hashing took " + std::to_string(::GetTickCount() - startTime_ms) + " ms (" +
+			std::to_string(a.lines.size()) + " / " + std::to_string(b.lines.size()) + " lines, " +
+			std::to_string(chunks.size()) + " chunks, " + std::to_string(threadsCount) + " threads)\n");
+}
+
+
+inline charType getCharTypeW(wchar_t letter)
+{
+	if (letter == L' ' || letter == L'\t')
+		return charType::SPACECHAR;
+
+	if (::IsCharAlphaNumericW(letter) || letter == L'_')
+		return charType::ALPHANUMCHAR;
+
+	return charType::OTHERCHAR;
+}
+
+
+inline void recalculateWordPos(int codepage, std::vector<Word>& words, const std::vector<wchar_t>& line)
+{
+	intptr_t bytePos = 0;
+	intptr_t currPos = 0;
+
+	for (auto& word : words)
+	{
+		if (currPos < word.pos)
+			bytePos += ::WideCharToMultiByte(codepage, 0, line.data() + currPos, static_cast<int>(word.pos - currPos),
+					NULL, 0, NULL, NULL);
+
+		currPos = word.pos + word.len;
+		word.len = ::WideCharToMultiByte(codepage, 0, line.data() + word.pos, static_cast<int>(word.len),
+				NULL, 0, NULL, NULL);
+		word.pos = bytePos;
+		bytePos += word.len;
+	}
+}
+
+
+inline uint64_t getWordHash(const std::vector<wchar_t>& line, const Word& word, const CompareOptions& options)
+{
+	LineHasher hasher(cHashSeed);
+
+	// All spaces words are considered equal
+	if (options.ignoreChangedSpaces && word.type == charType::SPACECHAR)
+		hasher.put(L' ');
+	else
+		hasher.update(line.data() + word.pos, word.len);
+
+	return hasher.digest();
 }
 
 
@@ -632,11 +1102,6 @@ inline void getSectionRangeWords(std::vector<Word>& words, std::vector<wchar_t>&
 
 	Word word {lineIdx, pos, 1, currentWordType};
 
-	if (options.ignoreChangedSpaces && currentWordType == charType::SPACECHAR)
-		word.hash = Hash(cHashSeed, L' ');
-	else
-		word.hash = Hash(cHashSeed, line[pos]);
-
 	for (; ++pos < endPos;)
 	{
 		const charType newWordType = getCharTypeW(line[pos]);
@@ -644,30 +1109,28 @@ inline void getSectionRangeWords(std::vector<Word>& words, std::vector<wchar_t>&
 		if (newWordType == currentWordType)
 		{
 			++word.len;
-
-			if (currentWordType != charType::SPACECHAR || !options.ignoreChangedSpaces)
-				word.hash = Hash(word.hash, line[pos]);
 		}
 		else
 		{
 			if (!options.ignoreAllSpaces || currentWordType != charType::SPACECHAR)
+			{
+				word.hash = getWordHash(line, word, options);
 				words.emplace_back(word);
+			}
 
 			currentWordType = newWordType;
 
 			word.pos = pos;
 			word.len = 1;
 			word.type = currentWordType;
-
-			if (options.ignoreChangedSpaces && currentWordType == charType::SPACECHAR)
-				word.hash = Hash(cHashSeed, L' ');
-			else
-				word.hash = Hash(cHashSeed, line[pos]);
 		}
 	}
 
 	if (!options.ignoreAllSpaces || currentWordType != charType::SPACECHAR)
+	{
+		word.hash = getWordHash(line, word, options);
 		words.emplace_back(word);
+	}
 }
 
 
@@ -726,30 +1189,49 @@ std::vector<Word> getRegexIgnoreLineWords(std::vector<wchar_t>& line, intptr_t l
 }
 
 
-std::vector<Word> getLineWords(int view, int codepage, intptr_t docLine,
-	const CompareOptions& options, intptr_t lineIdx = 0)
+inline bool isLongLine(intptr_t len, const CompareOptions& options)
 {
-	std::vector<Word> words;
+	return (options.longLineLen > 0 && len > options.longLineLen);
+}
 
-	const intptr_t lineStart	= getLineStart(view, docLine);
-	const intptr_t lineEnd		= getLineEnd(view, docLine);
 
-	if (lineStart >= lineEnd)
-		return words;
+// Checks if the line can be cut at pos without changing its words - both bytes around are ASCII of different types
+inline bool isLongLineCut(std::string_view line, intptr_t pos)
+{
+	if (pos <= 0 || pos >= static_cast<intptr_t>(line.size()))
+		return false;
 
-	std::vector<char> line = getText(view, lineStart, lineEnd);
+	const unsigned char prev = static_cast<unsigned char>(line[pos - 1]);
+	const unsigned char next = static_cast<unsigned char>(line[pos]);
 
-	const int len = static_cast<int>(line.size());
+	// The byte before prev is checked too so prev is not a DBCS trail byte
+	if (prev >= 0x80 || next >= 0x80 || (pos > 1 && static_cast<unsigned char>(line[pos - 2]) >= 0x80))
+		return false;
+
+	const charType prevType = getCharTypeW(static_cast<wchar_t>(prev));
+	const charType nextType = getCharTypeW(static_cast<wchar_t>(next));
+
+	return (prevType != nextType && prevType != charType::SPACECHAR && nextType != charType::SPACECHAR);
+}
+
+
+void getSectionWords(std::vector<Word>& words, std::string_view sec, intptr_t secPos, int codepage,
+	const CompareOptions& options, intptr_t lineIdx)
+{
+	const int len = static_cast<int>(sec.size());
 
-	const int wLen = ::MultiByteToWideChar(codepage, 0, line.data(), len, NULL, 0);
+	// Leave room for terminating null - the section is not null-terminated as it points directly to the doc buffer
+	const int wLen = ::MultiByteToWideChar(codepage, 0, sec.data(), len, NULL, 0) + 1;
 
-	std::vector<wchar_t> wLine(wLen);
+	std::vector<wchar_t> wSec(wLen, L'\0');
 
-	::MultiByteToWideChar(codepage, 0, line.data(), len, wLine.data(), wLen);
+	::MultiByteToWideChar(codepage, 0, sec.data(), len, wSec.data(), wLen - 1);
+
+	std::vector<Word> secWords;
 
 	if (options.ignoreRegex)
 	{
-		words = getRegexIgnoreLineWords(wLine, lineIdx, options);
+		secWords = getRegexIgnoreLineWords(wSec, lineIdx, options);
 	}
 	else
 	{
@@ -758,32 +1240,65 @@ std::vector<Word> getLineWords(int view, int codepage, intptr_t docLine,
 
 		if (options.ignoreChangedSpaces)
 		{
-			while (pos < endPos && (wLine[pos] == L' ' || wLine[pos] == L'\t'))
+			while (pos < endPos && (wSec[pos] == L' ' || wSec[pos] == L'\t'))
 				++pos;
 
-			while (--endPos >= pos && (wLine[endPos] == L' ' || wLine[endPos] == L'\t'));
+			while (--endPos >= pos && (wSec[endPos] == L' ' || wSec[endPos] == L'\t'));
 
 			++endPos;
 		}
 
-		getSectionRangeWords(words, wLine, lineIdx, pos, endPos, options);
+		getSectionRangeWords(secWords, wSec, lineIdx, pos, endPos, options);
 	}
 
 	// In case of UTF-16 or UTF-32 find words byte positions and lengths because Scintilla uses those
-	if (wLen != len)
-		recalculateWordPos(codepage, words, wLine);
+	if (wLen - 1 != len)
+		recalculateWordPos(codepage, secWords, wSec);
 
-	return words;
+	for (auto& word : secWords)
+		word.pos += secPos;
+
+	words.insert(words.end(), secWords.begin(), secWords.end());
 }
 
 
-std::pair<std::vector<Word>, std::unordered_map<intptr_t, range_t>> getLinesRangeWords(const DocCmpInfo& doc,
-	const range_t& range, intptr_t diffIdx, const CompareOptions& options)
+// The line might be just a part (starting at linePos) of the doc line - words positions are from the doc line start
+std::vector<Word> getLineWords(std::string_view line, int codepage, const CompareOptions& options, intptr_t lineIdx = 0,
+	intptr_t linePos = 0)
 {
-	const int codepage = getCodepage(doc.view);
+	std::vector<Word> words;
+
+	if (line.empty())
+		return words;
+
+	const intptr_t len = static_cast<intptr_t>(line.size());
+
+	// Long lines are widened and split in windows cut at word boundaries so the widened text stays small - the words
+	// are the same as if split at once (only ignore regex matches can't span windows)
+	const intptr_t window = isLongLine(len, options) ? cLongLineCharWindow : len;
+
+	for (intptr_t pos = 0; pos < len;)
+	{
+		intptr_t endPos = std::min(pos + window, len);
+
+		while (endPos < len && !isLongLineCut(line, endPos))
+			++endPos;
+
+		getSectionWords(words, line.substr(pos, endPos - pos), linePos + pos, codepage, options, lineIdx);
+
+		pos = endPos;
+	}
+
+	return words;
+}
 
+
+// lineClip (if given) is the part of the range's only line to get words from
+std::pair<std::vector<Word>, FlatHashMap<intptr_t, range_t>> getLinesRangeWords(const DocCmpInfo& doc,
+	const range_t& range, intptr_t diffIdx, const CompareOptions& options, const range_t* lineClip = nullptr)
+{
 	std::vector<Word> words;
-	std::unordered_map<intptr_t, range_t> lineWordsRange;
+	FlatHashMap<intptr_t, range_t> lineWordsRange;
 
 	for (intptr_t l = range.s; l < range.e; ++l)
 	{
@@ -796,17 +1311,26 @@ std::pair<std::vector<Word>, std::unordered_map<intptr_t, range_t>> getLinesRang
 				break;
 		}
 
-		std::vector<Word> lineWords = getLineWords(doc.view, codepage, doc.getDocLine(l), options, lIdx);
+		std::string_view line = doc.getLineText(diffIdx, lIdx);
+		intptr_t linePos = 0;
+
+		if (lineClip)
+		{
+			line = line.substr(lineClip->s, lineClip->len());
+			linePos = lineClip->s;
+		}
+
+		std::vector<Word> lineWords = getLineWords(line, doc.codepage, options, lIdx, linePos);
 
 		if (!lineWords.empty())
 		{
 			const intptr_t rangeS = static_cast<intptr_t>(words.size());
 			words.insert(words.end(), lineWords.begin(), lineWords.end());
-			lineWordsRange.emplace(lIdx, range_t(rangeS, static_cast<intptr_t>(words.size())));
+			lineWordsRange.try_emplace(lIdx, rangeS, static_cast<intptr_t>(words.size()));
 		}
 	}
 
-	return std::make_pair(words, lineWordsRange);
+	return std::make_pair(std::move(words), std::move(lineWordsRange));
 }
 
 
@@ -868,56 +1392,49 @@ inline void getSectionRangeChars(std::vector<Char>& chars, std::vector<wchar_t>&
 }
 
 
-std::vector<Char> getSectionChars(int view, intptr_t secStart, intptr_t secEnd, const CompareOptions& options)
+std::vector<Char> getSectionChars(std::string_view sec, int codepage, const CompareOptions& options)
 {
 	std::vector<Char> chars;
 
-	if (secStart >= secEnd)
+	if (sec.empty())
 		return chars;
 
-	const int codepage = getCodepage(view);
-
-	std::vector<char> sec = getText(view, secStart, secEnd);
-
 	const int len = static_cast<int>(sec.size());
 
-	const int wLen = ::MultiByteToWideChar(codepage, 0, sec.data(), len, NULL, 0);
+	// Leave room for terminating null - the section is not null-terminated as it points directly to the doc buffer
+	const int wLen = ::MultiByteToWideChar(codepage, 0, sec.data(), len, NULL, 0) + 1;
 
-	std::vector<wchar_t> wSec(wLen);
+	std::vector<wchar_t> wSec(wLen, L'\0');
 
-	::MultiByteToWideChar(codepage, 0, sec.data(), len, wSec.data(), wLen);
+	::MultiByteToWideChar(codepage, 0, sec.data(), len, wSec.data(), wLen - 1);
 
 	chars.reserve(wLen - 1);
 
 	getSectionRangeChars(chars, wSec, 0, wLen - 1, options);
 
 	// In case of UTF-16 or UTF-32 find chars byte positions because Scintilla uses those
-	if (wLen != len)
+	if (wLen - 1 != len)
 		recalculateCharPos(codepage, chars, wSec);
 
 	return chars;
 }
 
 
-std::vector<Char> getRegexIgnoreLineChars(int view, intptr_t lineStart, intptr_t lineEnd,
-	const CompareOptions& options)
+std::vector<Char> getRegexIgnoreLineChars(std::string_view line, int codepage, const CompareOptions& options)
 {
 	std::vector<Char> chars;
 
-	if (lineStart >= lineEnd)
+	if (line.empty())
 		return chars;
 
-	const int codepage = getCodepage(view);
-
-	std::vector<char> line = getText(view, lineStart, lineEnd);
-
 	const int len = static_cast<int>(line.size());
 
-	const int wLen = ::MultiByteToWideChar(codepage, 0, line.data(), len, NULL, 0);
+	// Leave room for terminating null - the line is not null-terminated as it points directly to the doc buffer
+	const int wLen = ::MultiByteToWideChar(codepage, 0, line.data(), len, NULL, 0) + 1;
 
-	std::vector<wchar_t> wLine(wLen);
+	std::vector<wchar_t> wLine(wLen, L'\0');
 
-	::MultiByteToWideChar(codepage, 0, line.data(), len, wLine.data(), wLen);
+	::MultiByteToWideChar(codepage, 0, line.data(), len, wLine.data(), wLen - 1);
 
 	chars.reserve(wLen - 1);
 
@@ -960,31 +1477,29 @@ std::vector<Char> getRegexIgnoreLineChars(int view, intptr_t lineStart, intptr_t
 	}
 
 	// In case of UTF-16 or UTF-32 find chars byte positions because Scintilla uses those
-	if (wLen != len)
+	if (wLen - 1 != len)
 		recalculateCharPos(codepage, chars, wLine);
 
 	return chars;
 }
 
 
-inline std::vector<Char> getLineChars(const DocCmpInfo& doc, const diff_info& bd, intptr_t lineIdx,
+inline std::vector<Char> getLineChars(const DocCmpInfo& doc, intptr_t diffIdx, intptr_t lineIdx,
 	const CompareOptions& options)
 {
 	std::vector<Char> chars;
 
-	const intptr_t docLine		= doc.getDocLine(bd, lineIdx);
-	const intptr_t lineStart	= getLineStart(doc.view, docLine);
-	const intptr_t lineEnd		= getLineEnd(doc.view, docLine);
+	const std::string_view line = doc.getLineText(diffIdx, lineIdx);
 
-	if (lineStart < lineEnd)
+	if (!line.empty())
 	{
 		if (options.ignoreRegex)
 		{
-			chars = getRegexIgnoreLineChars(doc.view, lineStart, lineEnd, options);
+			chars = getRegexIgnoreLineChars(line, doc.codepage, options);
 		}
 		else
 		{
-			chars = getSectionChars(doc.view, lineStart, lineEnd, options);
+			chars = getSectionChars(line, doc.codepage, options);
 
 			if (options.ignoreChangedSpaces && !chars.empty())
 			{
@@ -1025,40 +1540,82 @@ std::vector<std::vector<Char>> getLinesChars(const DocCmpInfo& doc, const diff_i
 			continue;
 		}
 
-		chars[l] = getLineChars(doc, bd, l, options);
+		chars[l] = getLineChars(doc, diffIdx, l, options);
 	}
 
 	return chars;
 }
 
 
-void findUniqueLines(CompareInfo& cmpInfo)
+// Checks if the changed block has long lines - those are compared in long-line mode
+bool hasLongLines(const DocCmpInfo& doc, intptr_t diffIdx, const CompareOptions& options)
 {
-	std::unordered_map<Line::HashType, std::vector<intptr_t>> aLinesMap;
-
-	for (const auto& line : cmpInfo.a.lines)
+	for (const auto& pos : doc.linesPos[diffIdx])
 	{
-		auto insertPair = aLinesMap.emplace(line.hash, std::vector<intptr_t>{line.num});
-		if (!insertPair.second)
-			insertPair.first->second.emplace_back(line.num);
+		if (isLongLine(pos.len(), options))
+			return true;
 	}
 
-	for (const auto& line : cmpInfo.b.lines)
-	{
-		auto a = aLinesMap.find(line.hash);
+	return false;
+}
+
 
-		if (a != aLinesMap.end())
+// Maps the lines hashes of both docs to dense class IDs (equal lines get the same ID) and counts the lines per class
+void internLines(DocCmpInfo& a, DocCmpInfo& b)
+{
+	FlatHashMap<Line::HashType, uint32_t> classIds(a.lines.size() + b.lines.size());
+
+	auto intern =
+		[&](DocCmpInfo& doc)
 		{
-			cmpInfo.b.nonUniqueDocLines.emplace(line.num);
+			doc.lineIds.clear();
+			doc.lineIds.reserve(doc.lines.size());
 
-			auto insertPair = cmpInfo.a.nonUniqueDocLines.emplace(a->second[0]);
-			if (insertPair.second)
+			doc.linesFingerprint = cHashSeed;
+
+			for (const auto& line : doc.lines)
 			{
-				for (size_t j = 1; j < a->second.size(); ++j)
-					cmpInfo.a.nonUniqueDocLines.emplace(a->second[j]);
+				doc.lineIds.emplace_back(
+						classIds.try_emplace(line.hash, static_cast<uint32_t>(classIds.size())).first->second);
+
+				doc.linesFingerprint = (doc.linesFingerprint ^ line.hash) * 0x100000001B3ULL;
 			}
-		}
-	}
+		};
+
+	intern(a);
+	intern(b);
+
+	auto countClasses =
+		[&](DocCmpInfo& doc)
+		{
+			doc.classCount.assign(classIds.size(), 0);
+
+			for (const auto& id : doc.lineIds)
+				++doc.classCount[id.hash];
+		};
+
+	countClasses(a);
+	countClasses(b);
+}
+
+
+// Only the diff lines' flags are needed (and set) - the matching lines are present in both docs anyway
+void findUniqueLines(CompareInfo& cmpInfo)
+{
+	auto findNonUnique =
+		[&](DocCmpInfo& doc, const DocCmpInfo& otherDoc)
+		{
+			doc.nonUniqueLines.assign(doc.lineIds.size(), false);
+
+			for (const auto& bd : cmpInfo.blockDiffs)
+			{
+				for (intptr_t i = doc.diffRange(bd).s; i < doc.diffRange(bd).e; ++i)
+					doc.nonUniqueLines[i] = (otherDoc.classCount[doc.lineIds[i].hash] != 0);
+			}
+		};
+
+	findNonUnique(cmpInfo.a, cmpInfo.b);
+	findNonUnique(cmpInfo.b, cmpInfo.a);
 }
 
 
@@ -1074,7 +1631,7 @@ void findMoves(CompareInfo& cmpInfo)
 
 	LOGD(LOG_ALGO, "FIND MOVES\n");
 
-	std::unordered_map<Line::HashType, MatchingLines> uniqueDiffLines;
+	FlatHashMap<uint32_t, MatchingLines> uniqueDiffLines;
 
 	const intptr_t blockDiffsSize = static_cast<intptr_t>(cmpInfo.blockDiffs.size());
 
@@ -1086,11 +1643,11 @@ void findMoves(CompareInfo& cmpInfo)
 		{
 			const Line& diffLine = cmpInfo.a.getLine(bd, l);
 
-			// Skip empty lines (do not show blocks of empty/ignored lines as moved)
-			if (diffLine.hash == cHashSeed)
+			// Skip empty lines (do not show blocks of empty/ignored lines as moved) and lines missing in the other doc
+			if (diffLine.hash == cHashSeed || !cmpInfo.a.isNonUnique(bd.a.s + l))
 				continue;
 
-			auto insertPair = uniqueDiffLines.emplace(diffLine.hash, MatchingLines{});
+			auto insertPair = uniqueDiffLines.try_emplace(cmpInfo.a.lineIds[bd.a.s + l].hash);
 			if (insertPair.first->second.diffIdxA == 0)
 			{
 				insertPair.first->second.diffIdxA = bi + 1;
@@ -1106,11 +1663,11 @@ void findMoves(CompareInfo& cmpInfo)
 		{
 			const Line& diffLine = cmpInfo.b.getLine(bd, l);
 
-			// Skip empty lines (do not show blocks of empty/ignored lines as moved)
-			if (diffLine.hash == cHashSeed)
+			// Skip empty lines (do not show blocks of empty/ignored lines as moved) and lines missing in the other doc
+			if (diffLine.hash == cHashSeed || !cmpInfo.b.isNonUnique(bd.b.s + l))
 				continue;
 
-			auto insertPair = uniqueDiffLines.emplace(diffLine.hash, MatchingLines{});
+			auto insertPair = uniqueDiffLines.try_emplace(cmpInfo.b.lineIds[bd.b.s + l].hash);
 			if (insertPair.first->second.diffIdxB == 0)
 			{
 				insertPair.first->second.diffIdxB = bi + 1;
@@ -1163,6 +1720,17 @@ void findMoves(CompareInfo& cmpInfo)
 			")   B range: [" + std::to_string(cmpInfo.b.getDocLine(diffB, startB + 1)) + ", " +
 				std::to_string(cmpInfo.b.getDocLine(diffB, endB)) + ")\n");
 	}
+
+	// The unique lines map order is not kept between compares - order the ranges so the same moves compare equal
+	auto orderRanges =
+		[](std::vector<MovedRanges>& movedRanges)
+		{
+			for (auto& ranges : movedRanges)
+				std::sort(ranges.begin(), ranges.end(), [](const range_t& l, const range_t& r) { return l.s < r.s; });
+		};
+
+	orderRanges(cmpInfo.a.movedRanges);
+	orderRanges(cmpInfo.b.movedRanges);
 }
 
 
@@ -1276,26 +1844,34 @@ bool findMovedRanges(const std::vector<Elem>& dataA, const std::vector<Elem>& da
 
 
 void compareLinesByWords(CompareInfo& cmpInfo, intptr_t diffIdx,
-	const std::map<intptr_t, ChangedLinesInfo<Word>>& lineMappings, const CompareOptions& options)
+	const std::map<intptr_t, ChangedLinesInfo<Word>>& lineMappings, const CompareOptions& options, DiffWorkspace& ws)
 {
-	DocCmpInfo&			a = cmpInfo.a;
-	DocCmpInfo&			b = cmpInfo.b;
-	const diff_info&	bd = cmpInfo.blockDiffs[diffIdx];
+	DocCmpInfo& a = cmpInfo.a;
+	DocCmpInfo& b = cmpInfo.b;
 
 	for (const auto& lm : lineMappings) // ordered line A - line B info
 	{
 		const ChangedLinesInfo<Word>& cl = lm.second;
 
-		const intptr_t lineA = a.getDocLine(bd, cl.lineIdxA);
-		const intptr_t lineB = b.getDocLine(bd, cl.lineIdxB);
+#ifndef MULTITHREAD
+		LOGD(LOG_ALGO, "Compare Lines " +
+			std::to_string(a.getDocLine(cmpInfo.blockDiffs[diffIdx], cl.lineIdxA) + 1) + " and " +
+			std::to_string(b.getDocLine(cmpInfo.blockDiffs[diffIdx], cl.lineIdxB) + 1) + "\n");
+#endif
 
-		LOGD(LOG_ALGO, "Compare Lines " + std::to_string(lineA + 1) + " and " + std::to_string(lineB + 1) + "\n");
+		// Long lines (minified files, huge records) are compared only by tokens anchored on the rare ones (histogram)
+		// - Myers refinement might take forever on them. Chars are compared in small changed sections only.
+		const bool longLines = isLongLine(a.getLineText(diffIdx, cl.lineIdxA).size(), options) ||
+				isLongLine(b.getLineText(diffIdx, cl.lineIdxB).size(), options);
 
 		// First use word granularity (find matching words) for better precision
 		const auto wordDiffs = DiffCalc<Word>(cl.lineA, cl.lineB,
-				std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()))(DiffAlg::MIXED, true, true);
+				std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()), &ws, options.fastApproxDiff)(
+						longLines ? DiffAlg::HISTOGRAM : DiffAlg::MIXED, true, true);
 
+#ifndef MULTITHREAD
 		PRINT_DIFFS("WORD DIFFS", wordDiffs);
+#endif
 
 		std::vector<changed_range_t> changesA;
 		std::vector<changed_range_t> changesB;
@@ -1346,31 +1922,43 @@ void compareLinesByWords(CompareInfo& cmpInfo, intptr_t diffIdx,
 				++ia;
 				++ib;
 
-				const intptr_t linePosA = getLineStart(a.view, lineA);
-				const intptr_t linePosB = getLineStart(b.view, lineB);
-
 				intptr_t offA = cl.lineA[wd.a.s].pos;
 				intptr_t endA = cl.lineA[wd.a.e - 1].pos + cl.lineA[wd.a.e - 1].len;
 
 				intptr_t offB = cl.lineB[wd.b.s].pos;
 				intptr_t endB = cl.lineB[wd.b.e - 1].pos + cl.lineB[wd.b.e - 1].len;
 
-				std::vector<Char> secA = getSectionChars(a.view, linePosA + offA, linePosA + endA, options);
-				std::vector<Char> secB = getSectionChars(b.view, linePosB + offB, linePosB + endB, options);
+				if (longLines && (endA - offA > cLongLineCharWindow || endB - offB > cLongLineCharWindow))
+				{
+					changedLineA.changes.emplace_back(offA, endA);
+					changedLineB.changes.emplace_back(offB, endB);
+
+					continue;
+				}
+
+				std::vector<Char> secA =
+						getSectionChars(a.getLineText(diffIdx, cl.lineIdxA).substr(offA, endA - offA), a.codepage, options);
+				std::vector<Char> secB =
+						getSectionChars(b.getLineText(diffIdx, cl.lineIdxB).substr(offB, endB - offB), b.codepage, options);
 
 				bool considerCharDiffs = options.detectCharDiffs;
 
 				if (options.detectCharDiffs)
 				{
+#ifndef MULTITHREAD
 					LOGD(LOG_ALGO, "Compare Sections " +
 							std::to_string(offA + 1) + " to " + std::to_string(endA + 1) + " and " +
 							std::to_string(offB + 1) + " to " + std::to_string(endB + 1) + "\n");
+#endif
 
 					// Compare changed words
 					const auto charDiffs = DiffCalc<Char>(secA, secB,
-							std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()))(DiffAlg::MYERS);
+							std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()), &ws, options.fastApproxDiff)(
+									DiffAlg::BIT_LCS);
 
+#ifndef MULTITHREAD
 					PRINT_DIFFS("CHAR DIFFS", charDiffs);
+#endif
 
 					intptr_t totalLen = secA.size() + secB.size();
 					intptr_t matchLen = totalLen;
@@ -1420,15 +2008,17 @@ void compareLinesByWords(CompareInfo& cmpInfo, intptr_t diffIdx,
 
 
 void compareLinesByChars(CompareInfo& cmpInfo, intptr_t diffIdx,
-	const std::map<intptr_t, ChangedLinesInfo<Char>>& lineMappings, const CompareOptions& options)
+	const std::map<intptr_t, ChangedLinesInfo<Char>>& lineMappings, const CompareOptions& options, DiffWorkspace& ws)
 {
 	for (const auto& lm : lineMappings) // ordered line A - line B info
 	{
 		const ChangedLinesInfo<Char>& cl = lm.second;
 
+#ifndef MULTITHREAD
 		LOGD(LOG_ALGO, "Compare Lines " +
 			std::to_string(cmpInfo.a.getDocLine(cmpInfo.blockDiffs[diffIdx], cl.lineIdxA) + 1) + " and " +
 			std::to_string(cmpInfo.b.getDocLine(cmpInfo.blockDiffs[diffIdx], cl.lineIdxB) + 1) + "\n");
+#endif
 
 		std::vector<changed_range_t> changesA;
 		std::vector<changed_range_t> changesB;
@@ -1440,9 +2030,12 @@ void compareLinesByChars(CompareInfo& cmpInfo, intptr_t diffIdx,
 		auto& changedLineB = cmpInfo.b.changedLines[diffIdx].back();
 
 		const auto charDiffs = DiffCalc<Char>(cl.lineA, cl.lineB,
-				std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()))(DiffAlg::MYERS);
+				std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()), &ws, options.fastApproxDiff)(
+						DiffAlg::BIT_LCS);
 
+#ifndef MULTITHREAD
 		PRINT_DIFFS("CHAR DIFFS", charDiffs);
+#endif
 
 		for (const auto& cd : charDiffs)
 		{
@@ -1481,33 +2074,41 @@ void compareLinesByChars(CompareInfo& cmpInfo, intptr_t diffIdx,
 
 
 inline std::span<Word> getLineSpan(
-	std::pair<std::vector<Word>, std::unordered_map<intptr_t, range_t>>& range, intptr_t idx)
+	std::pair<std::vector<Word>, FlatHashMap<intptr_t, range_t>>& range, intptr_t idx)
 {
 	assert(idx >= 0 && static_cast<size_t>(idx) < range.first.size());
 
-	auto itr = range.second.find(range.first[idx].lineIdx);
-	assert(itr != range.second.end());
+	const auto* itr = range.second.find(range.first[idx].lineIdx);
+	assert(itr);
 
 	return std::span<Word>(range.first.begin() + itr->second.s, static_cast<size_t>(itr->second.len()));
 }
 
 
-float findResemblance(const std::span<Word> sA, const std::span<Word> sB)
+// sameLen - bytes of both lines known to match that are not in the spans (clipped)
+float findResemblance(const std::span<Word> sA, const std::span<Word> sB, const CompareOptions& options,
+	DiffWorkspace& ws, intptr_t sameLen = 0)
 {
-	intptr_t totalLen = 0;
-	intptr_t matchLen = 0;
+	intptr_t lenA = sameLen;
+	intptr_t lenB = sameLen;
+	intptr_t matchLen = sameLen;
 
 	for (const auto& w : sA)
-		totalLen += w.len;
+		lenA += w.len;
 
 	for (const auto& w : sB)
-		totalLen += w.len;
+		lenB += w.len;
+
+	const intptr_t totalLen = lenA + lenB;
 
 	if (!totalLen)
 		return 0;
 
+	const bool longLines = isLongLine(lenA, options) || isLongLine(lenB, options);
+
 	const auto wordDiffs =
-			DiffCalc<Word>(sA, sB, std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()))(DiffAlg::MIXED);
+			DiffCalc<Word>(sA, sB, std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()), &ws,
+					options.fastApproxDiff)(longLines ? DiffAlg::HISTOGRAM : DiffAlg::MIXED);
 
 	const intptr_t wordDiffsSize = static_cast<intptr_t>(wordDiffs.size());
 
@@ -1530,7 +2131,8 @@ float findResemblance(const std::span<Word> sA, const std::span<Word> sB)
 }
 
 
-float findResemblance(const std::vector<Char> lA, const std::vector<Char> lB, int changedResemblPercent)
+float findResemblance(const std::vector<Char>& lA, const std::vector<Char>& lB, int changedResemblPercent,
+	DiffWorkspace& ws)
 {
 	const intptr_t minSize = std::min(lA.size(), lB.size());
 	const intptr_t maxSize = std::max(lA.size(), lB.size());
@@ -1538,17 +2140,13 @@ float findResemblance(const std::vector<Char> lA, const std::vector<Char> lB, in
 	if ((static_cast<float>(minSize * 2 * 100) / (minSize + maxSize)) < changedResemblPercent)
 		return 0;
 
-	const auto charDiffs =
-			DiffCalc<Char>(lA, lB, std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()))(DiffAlg::MYERS);
-
-	if (charDiffs.empty())
-		return 100.0;
-
+	// Only the matching chars count is needed - no edit script
+	const intptr_t matchLen = 2 * BitLcsDiff<Char>(std::bind(&ProgressDlg::ThrowIfCancelled, ProgressDlg::Get()),
+			&ws).length(lA.data(), lA.size(), lB.data(), lB.size());
 	const intptr_t totalLen = lA.size() + lB.size();
-	intptr_t matchLen = totalLen;
 
-	for (const auto& cd : charDiffs)
-		matchLen -= (cd.a.len() + cd.b.len());
+	if (matchLen == totalLen)
+		return 100.0;
 
 	const float conv = (static_cast<float>(matchLen * 100)) / totalLen;
 
@@ -1556,7 +2154,46 @@ float findResemblance(const std::vector<Char> lA, const std::vector<Char> lB, in
 }
 
 
-void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOptions& options)
+// Clips the changed pair of lines to their differing middle and a chars window around it (cut at word boundaries)
+// - returns the same head and tail bytes count clipped
+intptr_t clipLongLinesPair(std::string_view lineA, std::string_view lineB, range_t& clipA, range_t& clipB)
+{
+	const intptr_t lenA = static_cast<intptr_t>(lineA.size());
+	const intptr_t lenB = static_cast<intptr_t>(lineB.size());
+	const intptr_t minLen = std::min(lenA, lenB);
+
+	intptr_t head = 0;
+
+	while (head < minLen && lineA[head] == lineB[head])
+		++head;
+
+	intptr_t tail = 0;
+
+	while (tail < minLen - head && lineA[lenA - 1 - tail] == lineB[lenB - 1 - tail])
+		++tail;
+
+	// Cut points are taken in the same head / tail so they are word boundaries in both lines
+	intptr_t headCut = head - cLongLineCharWindow;
+
+	while (headCut > 0 && !isLongLineCut(lineA, headCut))
+		--headCut;
+
+	intptr_t tailCut = tail - cLongLineCharWindow;
+
+	while (tailCut > 0 && !isLongLineCut(lineA, lenA - tailCut))
+		--tailCut;
+
+	headCut = std::max<intptr_t>(headCut, 0);
+	tailCut = std::max<intptr_t>(tailCut, 0);
+
+	clipA = range_t(headCut, lenA - tailCut);
+	clipB = range_t(headCut, lenB - tailCut);
+
+	return headCut + tailCut;
+}
+
+
+void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOptions& options, DiffWorkspace& ws)
 {
 	struct MatchingWord // line idx -> word idx
 	{
@@ -1564,15 +2201,30 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 		std::map<intptr_t, intptr_t> b;
 	};
 
-	std::pair<std::vector<Word>, std::unordered_map<intptr_t, range_t>> wordsRangeA =
-			getLinesRangeWords(cmpInfo.a, cmpInfo.blockDiffs[diffIdx].a, diffIdx, options);
-	std::pair<std::vector<Word>, std::unordered_map<intptr_t, range_t>> wordsRangeB =
-			getLinesRangeWords(cmpInfo.b, cmpInfo.blockDiffs[diffIdx].b, diffIdx, options);
+	const range_t& blockA = cmpInfo.blockDiffs[diffIdx].a;
+	const range_t& blockB = cmpInfo.blockDiffs[diffIdx].b;
+
+	range_t clipA;
+	range_t clipB;
+	intptr_t clippedLen = 0;
+
+	// A changed pair of long lines (huge single-line records) is split to words only around its changed middle
+	const bool clipLines = (blockA.len() == 1 && blockB.len() == 1 &&
+			(hasLongLines(cmpInfo.a, diffIdx, options) || hasLongLines(cmpInfo.b, diffIdx, options)));
+
+	if (clipLines)
+		clippedLen = clipLongLinesPair(cmpInfo.a.getLineText(diffIdx, 0), cmpInfo.b.getLineText(diffIdx, 0),
+				clipA, clipB);
+
+	std::pair<std::vector<Word>, FlatHashMap<intptr_t, range_t>> wordsRangeA =
+			getLinesRangeWords(cmpInfo.a, blockA, diffIdx, options, clipLines ? &clipA : nullptr);
+	std::pair<std::vector<Word>, FlatHashMap<intptr_t, range_t>> wordsRangeB =
+			getLinesRangeWords(cmpInfo.b, blockB, diffIdx, options, clipLines ? &clipB : nullptr);
 
 	std::vector<Word>& wordsA = wordsRangeA.first;
 	std::vector<Word>& wordsB = wordsRangeB.first;
-	std::unordered_map<intptr_t, range_t>& lineWordsRangeA = wordsRangeA.second;
-	std::unordered_map<intptr_t, range_t>& lineWordsRangeB = wordsRangeB.second;
+	FlatHashMap<intptr_t, range_t>& lineWordsRangeA = wordsRangeA.second;
+	FlatHashMap<intptr_t, range_t>& lineWordsRangeB = wordsRangeB.second;
 
 	if (wordsA.empty() || wordsB.empty())
 		return;
@@ -1580,9 +2232,12 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 	// Ordered changed A-B lines info (line idx + chars)
 	std::map<intptr_t, ChangedLinesInfo<Word>> changedLines;
 
-	std::unordered_map<uint64_t, float> linesResemblance;
+	FlatHashMap<uint64_t, float> linesResemblance;
 	std::vector<range_t> stack;
 
+	// Reused for all the ranges below
+	FlatHashMap<Word::HashType, MatchingWord> wordMatchMap;
+
 	stack.emplace_back(0, static_cast<intptr_t>(wordsA.size()));
 	stack.emplace_back(0, static_cast<intptr_t>(wordsB.size()));
 
@@ -1600,16 +2255,17 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 			const uint64_t lines = (
 							static_cast<uint64_t>(wordsA[rangeA.s].lineIdx) << 31) |
 							static_cast<uint64_t>(wordsB[rangeB.s].lineIdx);
-			auto lItr = linesResemblance.find(lines);
+			const auto* lItr = linesResemblance.find(lines);
 
-			if (lItr != linesResemblance.end())
+			if (lItr)
 			{
 				resemblance = lItr->second;
 			}
 			else
 			{
-				resemblance = findResemblance(getLineSpan(wordsRangeA, rangeA.s), getLineSpan(wordsRangeB, rangeB.s));
-				linesResemblance.emplace(lines, resemblance);
+				resemblance = findResemblance(getLineSpan(wordsRangeA, rangeA.s), getLineSpan(wordsRangeB, rangeB.s),
+						options, ws, clippedLen);
+				linesResemblance.try_emplace(lines, resemblance);
 			}
 
 			if (resemblance >= options.changedResemblPercent)
@@ -1631,31 +2287,27 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 
 		for (int run = 2; run; --run)
 		{
-			std::unordered_map<Word::HashType, MatchingWord> wordMatchMap;
+			wordMatchMap.clear();
 
 			if (run == 2)
 			{
 				for (intptr_t i = rangeA.s; i < rangeA.e; ++i)
 					if (wordsA[i].type == charType::ALPHANUMCHAR)
-						wordMatchMap.emplace(
-							wordsA[i].hash, MatchingWord{}).first->second.a.emplace(wordsA[i].lineIdx, i);
+						wordMatchMap.try_emplace(wordsA[i].hash).first->second.a.emplace(wordsA[i].lineIdx, i);
 
 				for (intptr_t i = rangeB.s; i < rangeB.e; ++i)
 					if (wordsB[i].type == charType::ALPHANUMCHAR)
-						wordMatchMap.emplace(
-							wordsB[i].hash, MatchingWord{}).first->second.b.emplace(wordsB[i].lineIdx, i);
+						wordMatchMap.try_emplace(wordsB[i].hash).first->second.b.emplace(wordsB[i].lineIdx, i);
 			}
 			else
 			{
 				for (intptr_t i = rangeA.s; i < rangeA.e; ++i)
 					if (wordsA[i].type != charType::ALPHANUMCHAR)
-						wordMatchMap.emplace(
-							wordsA[i].hash, MatchingWord{}).first->second.a.emplace(wordsA[i].lineIdx, i);
+						wordMatchMap.try_emplace(wordsA[i].hash).first->second.a.emplace(wordsA[i].lineIdx, i);
 
 				for (intptr_t i = rangeB.s; i < rangeB.e; ++i)
 					if (wordsB[i].type != charType::ALPHANUMCHAR)
-						wordMatchMap.emplace(
-							wordsB[i].hash, MatchingWord{}).first->second.b.emplace(wordsB[i].lineIdx, i);
+						wordMatchMap.try_emplace(wordsB[i].hash).first->second.b.emplace(wordsB[i].lineIdx, i);
 			}
 
 			if (wordMatchMap.empty())
@@ -1682,9 +2334,9 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 						const uint64_t lines = (
 										static_cast<uint64_t>(m.second.a.begin()->first) << 31) |
 										static_cast<uint64_t>(m.second.b.begin()->first);
-						auto lItr = linesResemblance.find(lines);
+						const auto* lItr = linesResemblance.find(lines);
 
-						if (lItr != linesResemblance.end())
+						if (lItr)
 						{
 							resemblance = lItr->second;
 						}
@@ -1692,8 +2344,8 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 						{
 							resemblance = findResemblance(
 									getLineSpan(wordsRangeA, m.second.a.begin()->second),
-									getLineSpan(wordsRangeB, m.second.b.begin()->second));
-							linesResemblance.emplace(lines, resemblance);
+									getLineSpan(wordsRangeB, m.second.b.begin()->second), options, ws, clippedLen);
+							linesResemblance.try_emplace(lines, resemblance);
 						}
 
 						if (resemblance >= options.changedResemblPercent)
@@ -1715,11 +2367,11 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 		const intptr_t al = bestMatchingWord.a.begin()->first;
 		const intptr_t bl = bestMatchingWord.b.begin()->first;
 
-		auto lrA = lineWordsRangeA.find(al);
-		assert(lrA != lineWordsRangeA.end());
+		const auto* lrA = lineWordsRangeA.find(al);
+		assert(lrA);
 
-		auto lrB = lineWordsRangeB.find(bl);
-		assert(lrB != lineWordsRangeB.end());
+		const auto* lrB = lineWordsRangeB.find(bl);
+		assert(lrB);
 
 		{
 			auto lineSpanA = getLineSpan(wordsRangeA, bestMatchingWord.a.begin()->second);
@@ -1743,11 +2395,11 @@ void findChangesByWords(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 		}
 	}
 
-	compareLinesByWords(cmpInfo, diffIdx, changedLines, options);
+	compareLinesByWords(cmpInfo, diffIdx, changedLines, options, ws);
 }
 
 
-void findChangesByChars(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOptions& options)
+void findChangesByChars(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOptions& options, DiffWorkspace& ws)
 {
 	std::vector<std::vector<Char>> linesA = getLinesChars(cmpInfo.a, cmpInfo.blockDiffs[diffIdx], diffIdx, options);
 	std::vector<std::vector<Char>> linesB = getLinesChars(cmpInfo.b, cmpInfo.blockDiffs[diffIdx], diffIdx, options);
@@ -1758,7 +2410,7 @@ void findChangesByChars(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 	const intptr_t linesCountA = static_cast<intptr_t>(linesA.size());
 	const intptr_t linesCountB = static_cast<intptr_t>(linesB.size());
 
-	std::unordered_map<uint64_t, float> linesResemblance;
+	FlatHashMap<uint64_t, float> linesResemblance(linesCountA * linesCountB);
 
 	float bestResemblance = 0;
 	intptr_t bal = 0;
@@ -1775,8 +2427,8 @@ void findChangesByChars(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 				continue;
 
 			const uint64_t lines = (static_cast<uint64_t>(al << 31) | static_cast<uint64_t>(bl));
-			const float resemblance = findResemblance(linesA[al], linesB[bl], options.changedResemblPercent);
-			linesResemblance.emplace(lines, resemblance);
+			const float resemblance = findResemblance(linesA[al], linesB[bl], options.changedResemblPercent, ws);
+			linesResemblance.try_emplace(lines, resemblance);
 
 			if (resemblance > bestResemblance)
 			{
@@ -1836,8 +2488,8 @@ void findChangesByChars(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 					continue;
 
 				const uint64_t lines = (static_cast<uint64_t>(al << 31) | static_cast<uint64_t>(bl));
-				auto lItr = linesResemblance.find(lines);
-				assert(lItr != linesResemblance.end());
+				const auto* lItr = linesResemblance.find(lines);
+				assert(lItr);
 
 				if (lItr->second > bestResemblance)
 				{
@@ -1871,20 +2523,66 @@ void findChangesByChars(CompareInfo& cmpInfo, intptr_t diffIdx, const CompareOpt
 		}
 	}
 
-	compareLinesByChars(cmpInfo, diffIdx, changedLines, options);
+	compareLinesByChars(cmpInfo, diffIdx, changedLines, options, ws);
+}
+
+
+// Gets the doc text pointer and the positions of the changed blocks lines - Scintilla is called here only so the
+// sub-block compares can run in parallel afterwards
+void getSubBlocksLinesPos(DocCmpInfo& doc, const diff_results& blockDiffs, const std::vector<intptr_t>& changedBlockIdx)
+{
+	doc.codepage	= getCodepage(doc.view);
+	doc.text		= getRangePointer(doc.view, 0, CallScintilla(doc.view, SCI_GETLENGTH, 0, 0));
+
+	doc.linesPos.clear();
+	doc.linesPos.resize(blockDiffs.size());
+
+	const bool defaultEOLs = (CallScintilla(doc.view, SCI_GETLINEENDTYPESACTIVE, 0, 0) == SC_LINE_END_TYPE_DEFAULT);
+	const char* textEnd = doc.text + CallScintilla(doc.view, SCI_GETLENGTH, 0, 0);
+
+	for (intptr_t bi : changedBlockIdx)
+	{
+		const diff_info& bd = blockDiffs[bi];
+		const intptr_t linesCount = doc.diffRange(bd).len();
+
+		std::vector<range_t>& linesPos = doc.linesPos[bi];
+
+		linesPos.reserve(linesCount);
+
+		intptr_t prevDocLine = -2;
+
+		for (intptr_t l = 0; l < linesCount; ++l)
+		{
+			const intptr_t docLine = doc.getDocLine(bd, l);
+
+			// Scan consecutive lines in the text directly - Scintilla is asked only for the first line of each run
+			if (defaultEOLs)
+			{
+				const char* lineStart = (docLine == prevDocLine + 1) ?
+						skipEOL(doc.text + linesPos.back().e, textEnd) : doc.text + getLineStart(doc.view, docLine);
+
+				linesPos.emplace_back(lineStart - doc.text, findEOL(lineStart, textEnd) - doc.text);
+			}
+			else
+			{
+				linesPos.emplace_back(getLineStart(doc.view, docLine), getLineEnd(doc.view, docLine));
+			}
+
+			prevDocLine = docLine;
+		}
+	}
 }
 
 
-void findSubBlockDiffs(CompareInfo& cmpInfo, const CompareOptions& options)
+// Sub-compares the replaced blocks among block diffs [startBlock, endBlock)
+void findSubBlockDiffs(CompareInfo& cmpInfo, const CompareOptions& options, intptr_t startBlock, intptr_t endBlock)
 {
 	progress_ptr& progress = ProgressDlg::Get();
 
 	std::vector<intptr_t> changedBlockIdx;
 
-	const intptr_t blockDiffsSize = static_cast<intptr_t>(cmpInfo.blockDiffs.size());
-
 	// Get changed blocks to sub-compare
-	for (intptr_t i = 0; i < blockDiffsSize; ++i)
+	for (intptr_t i = startBlock; i < endBlock; ++i)
 	{
 		if (cmpInfo.blockDiffs[i].is_replacement())
 			changedBlockIdx.emplace_back(i);
@@ -1893,110 +2591,228 @@ void findSubBlockDiffs(CompareInfo& cmpInfo, const CompareOptions& options)
 	if (changedBlockIdx.empty())
 		return;
 
+	getSubBlocksLinesPos(cmpInfo.a, cmpInfo.blockDiffs, changedBlockIdx);
+	getSubBlocksLinesPos(cmpInfo.b, cmpInfo.blockDiffs, changedBlockIdx);
+
 	progress->SetMaxCount(static_cast<intptr_t>(changedBlockIdx.size()));
 
-// #ifdef MULTITHREAD // Do multithreaded block compares
+	// Each block writes its results only to its own changedLines[diffIdx] so they are the same no matter the order
+	// the blocks are processed in
+	auto compareBlock =
+		[&](intptr_t diffIdx, DiffWorkspace& ws)
+		{
+			// Long lines are never split to chars as a whole - their tokens are compared instead
+			if (options.detectCharDiffs && options.ignoreAllSpaces &&
+				!hasLongLines(cmpInfo.a, diffIdx, options) && !hasLongLines(cmpInfo.b, diffIdx, options))
+				findChangesByChars(cmpInfo, diffIdx, options, ws);
+			else
+				findChangesByWords(cmpInfo, diffIdx, options, ws);
+		};
+
+#ifdef MULTITHREAD
+	TaskPool& pool = TaskPool::Get();
+
+	unsigned threadsCount = pool.threadsCount();
 
-	// const int threadsCount = std::thread::hardware_concurrency() - 2;
+	if (threadsCount > 1 && changedBlockIdx.size() > 1)
+	{
+		threadsCount = std::min(threadsCount, static_cast<unsigned>(changedBlockIdx.size()));
 
-	// if (threadsCount > 0)
-	// {
-		// LOGD(LOG_ALL, "Changes detection running on " + std::to_string(threadsCount + 1) + " threads\n");
+		LOGD(LOG_ALGO, "Changes detection running on " + std::to_string(threadsCount) + " threads\n");
 
-		// std::atomic<size_t> blockIdx {0};
+		auto blockTextLen =
+			[&](intptr_t diffIdx)
+			{
+				intptr_t len = 0;
 
-		// auto threadFn =
-			// [&]()
-			// {
-				// for (size_t i = blockIdx++; i < changedBlockIdx.size(); i = blockIdx++)
-				// {
-					// if (options.detectCharDiffs && options.ignoreAllSpaces)
-						// findChangesByChars(cmpInfo, i, options);
-					// else
-						// findChangesByWords(cmpInfo, i, options);
+				for (const auto& pos : cmpInfo.a.linesPos[diffIdx])
+					len += pos.len();
 
-					// progress->Advance();
-				// }
-			// };
+				for (const auto& pos : cmpInfo.b.linesPos[diffIdx])
+					len += pos.len();
 
-		// std::vector<std::thread> threads(threadsCount);
+				return len;
+			};
 
-		// for (auto& th : threads)
-			// th = std::thread(threadFn);
+		std::vector<std::pair<intptr_t, intptr_t>> blocksBySize; // text len - diff idx
 
-		// threadFn();
+		blocksBySize.reserve(changedBlockIdx.size());
 
-		// for (auto& th : threads)
-			// th.join();
-	// }
-	// else
-	// {
-		// LOGD(LOG_ALL, "Changes detection running on 1 thread\n");
+		for (intptr_t bi : changedBlockIdx)
+			blocksBySize.emplace_back(blockTextLen(bi), bi);
 
-		// for (intptr_t i : changedBlockIdx)
-		// {
-			// if (options.detectCharDiffs && options.ignoreAllSpaces)
-				// findChangesByChars(cmpInfo, i, options);
-			// else
-				// findChangesByWords(cmpInfo, i, options);
+		// Biggest blocks are taken first so that a thread doesn't end up alone with a big block while the rest idle
+		std::sort(blocksBySize.begin(), blocksBySize.end(),
+			[](const auto& l, const auto& r) { return (l.first > r.first || (l.first == r.first && l.second < r.second)); });
 
-			// progress->Advance();
-		// }
-	// }
+		std::atomic<intptr_t> blocksDone {0};
 
-// #else // Do block compares in single thread
+		// Diff buffers reused for all the word and char compares done by the same pool thread
+		std::vector<DiffWorkspace> workspaces(pool.threadsCount());
 
-	for (intptr_t i : changedBlockIdx)
-	{
-		if (options.detectCharDiffs && options.ignoreAllSpaces)
-			findChangesByChars(cmpInfo, i, options);
-		else
-			findChangesByWords(cmpInfo, i, options);
+		// Each pool thread takes the next free block when done with the previous one
+		pool.run(blocksBySize.size(),
+			[&](size_t i, unsigned slot)
+			{
+				compareBlock(blocksBySize[i].second, workspaces[slot]);
+
+				++blocksDone;
 
-		progress->Advance();
+				// Progress updates are not thread-safe - leave them to the calling thread only
+				if (slot == 0)
+					progress->SetCount(blocksDone);
+			},
+			std::bind(&ProgressDlg::ThrowIfCancelled, progress));
 	}
+	else
+#endif // MULTITHREAD
+	{
+		// Diff buffers reused for all the word and char compares
+		DiffWorkspace ws;
+
+		for (intptr_t i : changedBlockIdx)
+		{
+			compareBlock(i, ws);
 
-// #endif // MULTITHREAD
+			progress->Advance();
+		}
+	}
 }
 
 
-inline void markLine(int view, intptr_t line, int mark)
+// Marks doc lines [line, endLine) - the mark is just collected, it is set in the view by applyViewMarks()
+inline void markLines(DocCmpInfo& doc, intptr_t line, intptr_t endLine, int mark)
 {
-	CallScintilla(view, SCI_ENSUREVISIBLE, line, 0);
-	CallScintilla(view, SCI_SHOWLINES, line, line);
-	CallScintilla(view, SCI_MARKERADDSET, line, mark);
+	if (line >= endLine)
+		return;
+
+	std::vector<ViewMarks::LinesMark>& lines = doc.marks.lines;
+
+	if (!lines.empty() && lines.back().e == line && lines.back().mask == mark)
+		lines.back().e = endLine;
+	else
+		lines.push_back({line, endLine, mark});
 }
 
 
-inline void markLinesBetween(int view, intptr_t& prevDocLine, intptr_t docLine, int mark)
+inline void markLine(DocCmpInfo& doc, intptr_t line, int mark)
 {
-	while (++prevDocLine < docLine)
-		markLine(view, prevDocLine, mark);
+	markLines(doc, line, line + 1, mark);
 }
 
 
-void markSection(const DocCmpInfo& doc, intptr_t bi, intptr_t diffOff, const CompareOptions& options)
+inline void markLinesBetween(DocCmpInfo& doc, intptr_t& prevDocLine, intptr_t docLine, int mark)
 {
-	const int diffMaskLocal =
-			(doc.diffMask == MARKER_MASK_ADDED) ? MARKER_MASK_ADDED_LOCAL : MARKER_MASK_REMOVED_LOCAL;
-	const intptr_t rangeEnd = doc.range.e - diffOff;
+	markLines(doc, prevDocLine + 1, docLine, mark);
 
-	intptr_t prevDocLine = doc.getDocLine(doc.range.s) - 1;
+	prevDocLine = std::max(prevDocLine + 1, docLine);
+}
 
-	for (intptr_t i = doc.range.s - diffOff, l = doc.range.s; i < rangeEnd; ++i, ++l)
+
+inline void markText(DocCmpInfo& doc, intptr_t pos, intptr_t len, int color)
+{
+	doc.marks.text.push_back({pos, len, color});
+}
+
+
+// Renders the compare marks in the view. The marked lines are made visible (unhidden and their folds expanded)
+// once per lines run and only if the view has hidden lines at all - not line by line.
+// If 'lines' is given only the marks of those doc lines are re-rendered - the rest of the view is kept as it is.
+void applyViewMarks(int view, const ViewMarks& marks, const range_t* lines = nullptr)
+{
+	const intptr_t linesCount = getLinesCount(view);
+
+	// Marks are cleared line by line in a range - at once it is cheaper for a big part of the doc
+	if (lines && lines->len() * 4 > linesCount)
+		lines = nullptr;
+
+	auto runsBegin	= marks.lines.begin();
+	auto runsEnd	= marks.lines.end();
+	auto textBegin	= marks.text.begin();
+	auto textEnd	= marks.text.end();
+
+	if (lines)
+	{
+		CallScintilla(view, SCI_ANNOTATIONCLEARALL, 0, 0);
+
+		if (!lines->len())
+			return;
+
+		clearMarks(view, lines->s, lines->len());
+
+		runsBegin = std::partition_point(runsBegin, runsEnd,
+				[&](const ViewMarks::LinesMark& m) { return m.e <= lines->s; });
+		runsEnd = std::partition_point(runsBegin, runsEnd,
+				[&](const ViewMarks::LinesMark& m) { return m.s < lines->e; });
+
+		const intptr_t startPos	= getLineStart(view, lines->s);
+		const intptr_t endPos	= (lines->e < linesCount) ? getLineStart(view, lines->e) : INTPTR_MAX;
+
+		textBegin = std::partition_point(textBegin, textEnd,
+				[&](const ViewMarks::TextMark& m) { return m.pos < startPos; });
+		textEnd = std::partition_point(textBegin, textEnd,
+				[&](const ViewMarks::TextMark& m) { return m.pos < endPos; });
+	}
+	else
+	{
+		clearWindow(view);
+	}
+
+	const bool allLinesVisible = (CallScintilla(view, SCI_GETALLLINESVISIBLE, 0, 0) != 0);
+
+	for (auto runIt = runsBegin; runIt != runsEnd; ++runIt)
+	{
+		ViewMarks::LinesMark run = *runIt;
+
+		if (lines)
+		{
+			run.s = std::max(run.s, lines->s);
+			run.e = std::min(run.e, lines->e);
+		}
+
+		if (!allLinesVisible)
+		{
+			CallScintilla(view, SCI_ENSUREVISIBLE, run.s, 0);
+
+			// Expand the contracted folds that hide the run's next lines
+			for (intptr_t foldLine = CallScintilla(view, SCI_CONTRACTEDFOLDNEXT, run.s, 0);
+					foldLine >= 0 && foldLine < run.e - 1;
+					foldLine = CallScintilla(view, SCI_CONTRACTEDFOLDNEXT, foldLine + 1, 0))
+				CallScintilla(view, SCI_FOLDLINE, foldLine, SC_FOLDACTION_EXPAND);
+
+			CallScintilla(view, SCI_SHOWLINES, run.s, run.e - 1);
+		}
+
+		for (intptr_t line = run.s; line < run.e; ++line)
+			CallScintilla(view, SCI_MARKERADDSET, line, run.mask);
+	}
+
+	for (auto tm = textBegin; tm != textEnd; ++tm)
+		markTextAsChanged(view, tm->pos, tm->len, tm->color);
+}
+
+
+void markSection(DocCmpInfo& doc, intptr_t bi, intptr_t diffOff, const CompareOptions& options)
+{
+	const int diffMaskLocal =
+			(doc.diffMask == MARKER_MASK_ADDED) ? MARKER_MASK_ADDED_LOCAL : MARKER_MASK_REMOVED_LOCAL;
+	const intptr_t rangeEnd = doc.range.e - diffOff;
+
+	intptr_t prevDocLine = doc.getDocLine(doc.range.s) - 1;
+
+	for (intptr_t i = doc.range.s - diffOff, l = doc.range.s; i < rangeEnd; ++i, ++l)
 	{
 		intptr_t docLine	= doc.getDocLine(l);
 		intptr_t movedLen	= doc.movedRanges[bi].rangeLen(i);
 
 		while (movedLen == 0)
 		{
-			const int mark = (doc.nonUniqueDocLines.find(docLine) ==
-					doc.nonUniqueDocLines.end()) ? doc.diffMask : diffMaskLocal;
+			const int mark = doc.isNonUnique(l) ? diffMaskLocal : doc.diffMask;
 
-			markLine(doc.view, docLine, mark);
+			markLine(doc, docLine, mark);
 
 			if (!options.neverMarkIgnored)
-				markLinesBetween(doc.view, prevDocLine, docLine, doc.diffMask);
+				markLinesBetween(doc, prevDocLine, docLine, doc.diffMask);
 
 			if (++i >= rangeEnd)
 				return;
@@ -2006,18 +2822,18 @@ void markSection(const DocCmpInfo& doc, intptr_t bi, intptr_t diffOff, const Com
 		}
 
 		if (!options.neverMarkIgnored)
-			markLinesBetween(doc.view, prevDocLine, docLine, doc.diffMask);
+			markLinesBetween(doc, prevDocLine, docLine, doc.diffMask);
 
 		if (i + movedLen > rangeEnd)
 			movedLen = rangeEnd - i;
 
 		if (movedLen == 1)
 		{
-			markLine(doc.view, docLine, MARKER_MASK_MOVED_SINGLE);
+			markLine(doc, docLine, MARKER_MASK_MOVED_SINGLE);
 		}
 		else
 		{
-			markLine(doc.view, docLine, MARKER_MASK_MOVED_BEGIN);
+			markLine(doc, docLine, MARKER_MASK_MOVED_BEGIN);
 
 			i += --movedLen;
 
@@ -2026,55 +2842,57 @@ void markSection(const DocCmpInfo& doc, intptr_t bi, intptr_t diffOff, const Com
 			while (++l < endL)
 			{
 				docLine = doc.getDocLine(l);
-				markLine(doc.view, docLine, MARKER_MASK_MOVED_MID);
+				markLine(doc, docLine, MARKER_MASK_MOVED_MID);
 
 				if (!options.neverMarkIgnored)
-					markLinesBetween(doc.view, prevDocLine, docLine, doc.diffMask);
+					markLinesBetween(doc, prevDocLine, docLine, doc.diffMask);
 			}
 
 			docLine = doc.getDocLine(l);
-			markLine(doc.view, docLine, MARKER_MASK_MOVED_END);
+			markLine(doc, docLine, MARKER_MASK_MOVED_END);
 
 			if (!options.neverMarkIgnored)
-				markLinesBetween(doc.view, prevDocLine, docLine, doc.diffMask);
+				markLinesBetween(doc, prevDocLine, docLine, doc.diffMask);
 		}
 	}
 }
 
 
-void markLineDiffs(const CompareInfo& cmpInfo, intptr_t bi, intptr_t ci)
+void markLineDiffs(CompareInfo& cmpInfo, intptr_t bi, intptr_t ci)
 {
 	const auto& changedLineA = cmpInfo.a.changedLines[bi][ci];
 	const auto& changedLineB = cmpInfo.b.changedLines[bi][ci];
 
 	intptr_t line = cmpInfo.a.getDocLine(cmpInfo.blockDiffs[bi], changedLineA.idx);
-	intptr_t linePos = getLineStart(cmpInfo.a.view, line);
+	intptr_t linePos = cmpInfo.a.linesPos[bi][changedLineA.idx].s;
 	int color = (cmpInfo.a.diffMask == MARKER_MASK_ADDED) ?
 			Settings.colors().added_part : Settings.colors().removed_part;
 
 	for (const auto& change : changedLineA.changes)
-		markTextAsChanged(cmpInfo.a.view, linePos + change.s, change.len(),
+		markText(cmpInfo.a, linePos + change.s, change.len(),
 						change.moved_to < 0 ? color : Settings.colors().moved_part);
 
-	markLine(cmpInfo.a.view, line, cmpInfo.a.nonUniqueDocLines.find(line) == cmpInfo.a.nonUniqueDocLines.end() ?
-			MARKER_MASK_CHANGED : MARKER_MASK_CHANGED_LOCAL);
+	markLine(cmpInfo.a, line,
+			cmpInfo.a.isNonUnique(cmpInfo.blockDiffs[bi].a.s + changedLineA.idx) ?
+			MARKER_MASK_CHANGED_LOCAL : MARKER_MASK_CHANGED);
 
 	line = cmpInfo.b.getDocLine(cmpInfo.blockDiffs[bi], changedLineB.idx);
-	linePos = getLineStart(cmpInfo.b.view, line);
+	linePos = cmpInfo.b.linesPos[bi][changedLineB.idx].s;
 	color = (cmpInfo.b.diffMask == MARKER_MASK_ADDED) ?
 			Settings.colors().added_part : Settings.colors().removed_part;
 
 	for (const auto& change : changedLineB.changes)
-		markTextAsChanged(cmpInfo.b.view, linePos + change.s, change.len(),
+		markText(cmpInfo.b, linePos + change.s, change.len(),
 						change.moved_to < 0 ? color : Settings.colors().moved_part);
 
-	markLine(cmpInfo.b.view, line, cmpInfo.b.nonUniqueDocLines.find(line) == cmpInfo.b.nonUniqueDocLines.end() ?
-			MARKER_MASK_CHANGED : MARKER_MASK_CHANGED_LOCAL);
+	markLine(cmpInfo.b, line,
+			cmpInfo.b.isNonUnique(cmpInfo.blockDiffs[bi].b.s + changedLineB.idx) ?
+			MARKER_MASK_CHANGED_LOCAL : MARKER_MASK_CHANGED);
 }
 
 
 inline void markReplacedBlockDiffRange(CompareInfo& cmpInfo, intptr_t bi, const CompareOptions& options,
-	CompareSummary& summary)
+	AlignmentInfo_t& alignmentInfo)
 {
 	if (cmpInfo.a.range.len() && cmpInfo.b.range.len())
 	{
@@ -2085,7 +2903,7 @@ inline void markReplacedBlockDiffRange(CompareInfo& cmpInfo, intptr_t bi, const
 		alignPair.sub.diffMask	= cmpInfo.b.diffMask;
 		alignPair.sub.line		= cmpInfo.b.getDocLine(cmpInfo.b.range.s);
 
-		summary.alignmentInfo.emplace_back(alignPair);
+		alignmentInfo.emplace_back(alignPair);
 
 		if (options.neverMarkIgnored)
 		{
@@ -2108,7 +2926,7 @@ inline void markReplacedBlockDiffRange(CompareInfo& cmpInfo, intptr_t bi, const
 						alignPair.main.line	= cmpInfo.a.getDocLine(*alignItrA);
 						alignPair.sub.line	= cmpInfo.b.getDocLine(l);
 
-						summary.alignmentInfo.emplace_back(alignPair);
+						alignmentInfo.emplace_back(alignPair);
 
 						if (++alignItrA == bdAlignIdxsA.end())
 							break;
@@ -2126,43 +2944,61 @@ inline void markReplacedBlockDiffRange(CompareInfo& cmpInfo, intptr_t bi, const
 }
 
 
-void markAllDiffs(CompareInfo& cmpInfo, const CompareOptions& options, CompareSummary& summary)
+// Aligns the lines following the last block diff - the alignment's closing pair
+void alignDocsEnd(const CompareInfo& cmpInfo, AlignmentInfo_t& alignmentInfo)
 {
-	clearWindow(MAIN_VIEW, false);
-	clearWindow(SUB_VIEW, false);
+	if (cmpInfo.a.lines.empty() || cmpInfo.b.lines.empty())
+		return;
 
-	progress_ptr& progress = ProgressDlg::Get();
+	const diff_info& lastDiff = cmpInfo.blockDiffs.back();
 
-	const intptr_t blockDiffsSize = static_cast<intptr_t>(cmpInfo.blockDiffs.size());
+	AlignmentPair alignPair;
 
-	progress->SetMaxCount(blockDiffsSize);
+	alignPair.main.line = lastDiff.a.e > 0 ?
+		cmpInfo.a.getDocLine(lastDiff.a.e - 1) + 1 :
+		cmpInfo.a.getDocLine(lastDiff.a.e);
 
-	intptr_t alignIdxA = 0;
-	intptr_t alignIdxB = 0;
+	alignPair.sub.line = lastDiff.b.e > 0 ?
+		cmpInfo.b.getDocLine(lastDiff.b.e - 1) + 1 :
+		cmpInfo.b.getDocLine(lastDiff.b.e);
 
-	AlignmentPair alignPair;
+	alignmentInfo.emplace_back(alignPair);
+}
 
-	for (intptr_t bi = 0; bi < blockDiffsSize; ++bi)
-	{
-		const diff_info& bd = cmpInfo.blockDiffs[bi];
-		intptr_t matchLen = bd.a.distance_from(alignIdxA);
 
-		if (matchLen > 0)
-		{
-			summary.match += matchLen;
+// Marks the block diffs [startBlock, endBlock) and aligns the lines from the end of the block before startBlock up to
+// the start of endBlock (up to the docs end if there are no blocks after)
+void markDiffs(CompareInfo& cmpInfo, const CompareOptions& options, AlignmentInfo_t& alignmentInfo,
+	intptr_t startBlock, intptr_t endBlock)
+{
+	const intptr_t blockDiffsSize = static_cast<intptr_t>(cmpInfo.blockDiffs.size());
 
+	intptr_t alignIdxA = startBlock ? cmpInfo.blockDiffs[startBlock - 1].a.e : 0;
+	intptr_t alignIdxB = startBlock ? cmpInfo.blockDiffs[startBlock - 1].b.e : 0;
+
+	AlignmentPair alignPair;
+
+	// Align all pairs of matching lines up to endIdxA
+	auto alignMatchingLines =
+		[&](intptr_t endIdxA)
+		{
 			alignPair.main.diffMask	= 0;
 			alignPair.sub.diffMask	= 0;
 
-			// Align all pairs of matching lines
-			while (matchLen--)
+			while (alignIdxA < endIdxA)
 			{
 				alignPair.main.line	= cmpInfo.a.getDocLine(alignIdxA++);
 				alignPair.sub.line	= cmpInfo.b.getDocLine(alignIdxB++);
 
-				summary.alignmentInfo.emplace_back(alignPair);
+				alignmentInfo.emplace_back(alignPair);
 			}
-		}
+		};
+
+	for (intptr_t bi = startBlock; bi < endBlock; ++bi)
+	{
+		const diff_info& bd = cmpInfo.blockDiffs[bi];
+
+		alignMatchingLines(bd.a.s);
 
 		if (bd.is_replacement())
 		{
@@ -2178,7 +3014,7 @@ void markAllDiffs(CompareInfo& cmpInfo, const CompareOptions& options, CompareSu
 				cmpInfo.b.range.s = alignIdxB;
 				cmpInfo.b.range.e = bd.b.s + cmpInfo.b.changedLines[bi][ci].idx;
 
-				markReplacedBlockDiffRange(cmpInfo, bi, options, summary);
+				markReplacedBlockDiffRange(cmpInfo, bi, options, alignmentInfo);
 
 				alignIdxA = cmpInfo.a.range.e;
 				alignIdxB = cmpInfo.b.range.e;
@@ -2189,7 +3025,7 @@ void markAllDiffs(CompareInfo& cmpInfo, const CompareOptions& options, CompareSu
 				alignPair.sub.diffMask	= MARKER_MASK_CHANGED;
 				alignPair.sub.line		= cmpInfo.b.getDocLine(alignIdxB++);
 
-				summary.alignmentInfo.emplace_back(alignPair);
+				alignmentInfo.emplace_back(alignPair);
 
 				markLineDiffs(cmpInfo, bi, ci);
 			}
@@ -2199,31 +3035,10 @@ void markAllDiffs(CompareInfo& cmpInfo, const CompareOptions& options, CompareSu
 			cmpInfo.b.range.s = alignIdxB;
 			cmpInfo.b.range.e = bd.b.e;
 
-			markReplacedBlockDiffRange(cmpInfo, bi, options, summary);
+			markReplacedBlockDiffRange(cmpInfo, bi, options, alignmentInfo);
 
 			alignIdxA = bd.a.e;
 			alignIdxB = bd.b.e;
-
-			const intptr_t movedLinesA = cmpInfo.a.movedRanges[bi].totalLinesCount();
-			const intptr_t movedLinesB = cmpInfo.b.movedRanges[bi].totalLinesCount();
-
-			const intptr_t newLinesA = bd.a.len() - changedCount - movedLinesA;
-			const intptr_t newLinesB = bd.b.len() - changedCount - movedLinesB;
-
-			summary.diffLines	+= newLinesA + newLinesB + changedCount;
-			summary.changed		+= changedCount;
-			summary.moved		+= movedLinesA + movedLinesB;
-
-			if (cmpInfo.a.diffMask == MARKER_MASK_ADDED)
-			{
-				summary.added	+= newLinesA;
-				summary.removed	+= newLinesB;
-			}
-			else
-			{
-				summary.added	+= newLinesB;
-				summary.removed	+= newLinesA;
-			}
 		}
 		else if (bd.a.len())
 		{
@@ -2231,16 +3046,6 @@ void markAllDiffs(CompareInfo& cmpInfo, const CompareOptions& options, CompareSu
 			cmpInfo.a.range.e = bd.a.e;
 			markSection(cmpInfo.a, bi, bd.a.s, options);
 
-			const intptr_t movedLines = cmpInfo.a.movedRanges[bi].totalLinesCount();
-
-			summary.diffLines	+= bd.a.len() - movedLines;
-			summary.moved		+= movedLines;
-
-			if (cmpInfo.a.diffMask == MARKER_MASK_ADDED)
-				summary.added += bd.a.len() - movedLines;
-			else
-				summary.removed += bd.a.len() - movedLines;
-
 			alignIdxA = bd.a.e;
 		}
 		else
@@ -2249,289 +3054,1255 @@ void markAllDiffs(CompareInfo& cmpInfo, const CompareOptions& options, CompareSu
 			cmpInfo.b.range.e = bd.b.e;
 			markSection(cmpInfo.b, bi, bd.b.s, options);
 
-			const intptr_t movedLines = cmpInfo.b.movedRanges[bi].totalLinesCount();
+			alignIdxB = bd.b.e;
+		}
+	}
 
-			summary.diffLines	+= bd.b.len() - movedLines;
-			summary.moved		+= movedLines;
+	if (endBlock < blockDiffsSize)
+		alignMatchingLines(cmpInfo.blockDiffs[endBlock].a.s);
+	else
+		alignDocsEnd(cmpInfo, alignmentInfo);
+}
 
-			if (cmpInfo.b.diffMask == MARKER_MASK_ADDED)
-				summary.added += bd.b.len() - movedLines;
-			else
-				summary.removed += bd.b.len() - movedLines;
 
-			alignIdxB = bd.b.e;
-		}
+// Counts the diff lines of all block diffs - changedCounts are the changed lines pairs per block
+void countDiffs(const CompareInfo& cmpInfo, const std::vector<intptr_t>& changedCounts, CompareSummary& summary)
+{
+	const intptr_t blockDiffsSize = static_cast<intptr_t>(cmpInfo.blockDiffs.size());
 
-		progress->Advance();
-	}
+	intptr_t diffLinesA = 0;
 
-	if (!cmpInfo.a.lines.empty() && !cmpInfo.b.lines.empty())
+	for (intptr_t bi = 0; bi < blockDiffsSize; ++bi)
 	{
-		alignPair.main.diffMask	= 0;
-		alignPair.main.line		= cmpInfo.blockDiffs.back().a.e > 0 ?
-			cmpInfo.a.getDocLine(cmpInfo.blockDiffs.back().a.e - 1) + 1 :
-			cmpInfo.a.getDocLine(cmpInfo.blockDiffs.back().a.e);
+		const diff_info& bd = cmpInfo.blockDiffs[bi];
 
-		alignPair.sub.diffMask	= 0;
-		alignPair.sub.line		= cmpInfo.blockDiffs.back().b.e > 0 ?
-			cmpInfo.b.getDocLine(cmpInfo.blockDiffs.back().b.e - 1) + 1 :
-			cmpInfo.b.getDocLine(cmpInfo.blockDiffs.back().b.e);
+		const intptr_t changedCount	= changedCounts[bi];
+		const intptr_t movedLinesA	= cmpInfo.a.movedRanges[bi].totalLinesCount();
+		const intptr_t movedLinesB	= cmpInfo.b.movedRanges[bi].totalLinesCount();
 
-		summary.alignmentInfo.emplace_back(alignPair);
-	}
+		const intptr_t newLinesA = bd.a.len() - changedCount - movedLinesA;
+		const intptr_t newLinesB = bd.b.len() - changedCount - movedLinesB;
 
-	if (blockDiffsSize)
-		summary.match += cmpInfo.a.lines.size() - cmpInfo.blockDiffs.back().a.e;
+		summary.diffLines	+= newLinesA + newLinesB + changedCount;
+		summary.changed		+= changedCount;
+		summary.moved		+= movedLinesA + movedLinesB;
 
-	summary.moved /= 2;
+		if (cmpInfo.a.diffMask == MARKER_MASK_ADDED)
+		{
+			summary.added	+= newLinesA;
+			summary.removed	+= newLinesB;
+		}
+		else
+		{
+			summary.added	+= newLinesB;
+			summary.removed	+= newLinesA;
+		}
 
-	progress->NextPhase();
+		diffLinesA += bd.a.len();
+	}
+
+	summary.match = static_cast<intptr_t>(cmpInfo.a.lines.size()) - diffLinesA;
+	summary.moved /= 2;
 }
 
 
-void toDocLineDiffSections(CompareInfo& cmpInfo)
+#ifdef MULTITHREAD
+
+// The diffs marks found so far by the compare worker - shown by the GUI thread while the compare goes on
+struct CompareStage
 {
-	DocCmpInfo&	a = cmpInfo.a;
-	DocCmpInfo&	b = cmpInfo.b;
+	std::mutex	mutex;
+	HANDLE		readyEvent {NULL};
+	ViewMarks	marks[2];
+	bool		ready {false};
+};
 
-	for (auto& bd : cmpInfo.blockDiffs)
-	{
-		bd.a.s = a.getDocLine(bd.a.s);
-		bd.a.e = a.getDocLine(bd.a.e);
-		bd.b.s = b.getDocLine(bd.b.s);
-		bd.b.e = b.getDocLine(bd.b.e);
-	}
-}
+// Set only while the compare runs on the worker thread
+CompareStage* compareStage = nullptr;
 
 
-CompareResult runCompare(const CompareOptions& options, CompareSummary& summary)
+// Passes the diffs found so far (block diffs first, then moves) to the GUI thread to be shown before the compare ends
+void showCompareStage(CompareInfo& cmpInfo, const CompareOptions& options)
 {
-	progress_ptr& progress = ProgressDlg::Get();
-
-	summary.clear();
+	if (!compareStage)
+		return;
 
-	CompareInfo cmpInfo;
+	// The marks collected while getting the lines are still needed for the final results
+	ViewMarks aMarks = cmpInfo.a.marks;
+	ViewMarks bMarks = cmpInfo.b.marks;
 
-	if (options.selectionCompare)
-	{
-		cmpInfo.a.range.s = options.selections[cmpInfo.a.view].first;
-		cmpInfo.a.range.e = options.selections[cmpInfo.a.view].second + 1;
+	AlignmentInfo_t stageAlignment;
 
-		cmpInfo.b.range.s = options.selections[cmpInfo.b.view].first;
-		cmpInfo.b.range.e = options.selections[cmpInfo.b.view].second + 1;
-	}
+	markDiffs(cmpInfo, options, stageAlignment, 0, static_cast<intptr_t>(cmpInfo.blockDiffs.size()));
 
-	cmpInfo.a.diffMask = (options.newFileViewId == cmpInfo.a.view) ? MARKER_MASK_ADDED : MARKER_MASK_REMOVED;
-	cmpInfo.b.diffMask = (options.newFileViewId == cmpInfo.a.view) ? MARKER_MASK_REMOVED : MARKER_MASK_ADDED;
+	std::swap(cmpInfo.a.marks, aMarks);
+	std::swap(cmpInfo.b.marks, bMarks);
 
-	LOGD_GET_TIME;
+	{
+		std::lock_guard<std::mutex> lock(compareStage->mutex);
 
-	getLines(cmpInfo.a, options);
+		compareStage->marks[cmpInfo.a.view]	= std::move(aMarks);
+		compareStage->marks[cmpInfo.b.view]	= std::move(bMarks);
+		compareStage->ready					= true;
+	}
 
-	progress->NextPhase();
+	::SetEvent(compareStage->readyEvent);
+}
 
-	getLines(cmpInfo.b, options);
+#else // MULTITHREAD not defined
 
-	progress->NextPhase();
+// The compare runs on the GUI thread - nothing can be shown before it ends
+inline void showCompareStage(CompareInfo&, const CompareOptions&) {}
 
-	cmpInfo.blockDiffs = DiffCalc<Line>(cmpInfo.a.lines, cmpInfo.b.lines,
-			std::bind(&ProgressDlg::ThrowIfCancelled, progress))(DiffAlg::MIXED,
-			options.ignoreAllSpaces || options.ignoreChangedSpaces, true, options.syncPoints);
+#endif // MULTITHREAD
 
-	LOGD_GET_TIME;
-	PRINT_DIFFS("COMPARE START - LINE DIFFS", cmpInfo.blockDiffs);
 
-	if (cmpInfo.blockDiffs.empty())
-		return CompareResult::COMPARE_MATCH;
+// The compared lines of both docs are the same as in the last compare - so are their line diffs then
+bool sameComparedLines(const CompareInfo& cmpInfo, const CompareState& state)
+{
+	// The fingerprints tell apart the changed docs at once - the lines are walked only to be sure when they match
+	for (const DocCmpInfo* doc : { &cmpInfo.a, &cmpInfo.b })
+	{
+		const CompareState::ViewState& old = state.views[doc->view];
 
-	cmpInfo.a.changedLines.resize(cmpInfo.blockDiffs.size());
-	cmpInfo.b.changedLines.resize(cmpInfo.blockDiffs.size());
-	cmpInfo.a.movedRanges.resize(cmpInfo.blockDiffs.size());
-	cmpInfo.b.movedRanges.resize(cmpInfo.blockDiffs.size());
+		if (old.comparedHashes.size() != doc->lines.size() || old.comparedFingerprint != doc->linesFingerprint)
+			return false;
+	}
 
-	findUniqueLines(cmpInfo);
+	for (const DocCmpInfo* doc : { &cmpInfo.a, &cmpInfo.b })
+	{
+		const std::vector<uint64_t>& oldHashes = state.views[doc->view].comparedHashes;
 
-	if (options.detectMoves)
-		findMoves(cmpInfo);
+		for (size_t i = 0; i < oldHashes.size(); ++i)
+		{
+			if (oldHashes[i] != doc->lines[i].hash)
+				return false;
+		}
+	}
 
-	progress->NextPhase();
+	return true;
+}
 
-	if (options.detectSubBlockDiffs)
-		findSubBlockDiffs(cmpInfo, options);
 
-	progress->NextPhase();
+// Diff blocks at the start and at the end that are the same as in the last compare and lie outside the doc lines
+// changed since - their sub-block diffs, marks and alignment are taken from the last compare
+struct ReusedBlocks
+{
+	intptr_t	startCount {0};
+	intptr_t	endCount {0};
+
+	// Per view
+	range_t		docLines[2];		// Doc lines between the start and the end blocks - the only ones marked anew
+	intptr_t	idxDelta[2] {};		// End blocks' compared lines index shift
+	intptr_t	lineDelta[2] {};	// End blocks' doc lines shift
+	intptr_t	posDelta[2] {};		// End blocks' doc position shift
+};
 
-	// Make sure we have at least one line in each view so the functions' logic below works properly
-	if (cmpInfo.a.lines.empty())
-		cmpInfo.a.lines.emplace_back(0, cHashSeed);
-	if (cmpInfo.b.lines.empty())
-		cmpInfo.b.lines.emplace_back(0, cHashSeed);
 
-	markAllDiffs(cmpInfo, options, summary);
+// The block's moves and non-unique lines are the same as in the last compare (its sub-block diffs depend on those)
+bool sameBlockResults(const DocCmpInfo& doc, intptr_t bi, const CompareState::ViewState& old, intptr_t oldBi,
+	const range_t& lines, intptr_t idxDelta)
+{
+	const MovedRanges& moved = doc.movedRanges[bi];
+	const std::vector<range_t>& oldMoved = old.movedRanges[oldBi];
 
-	toDocLineDiffSections(cmpInfo);
+	if (moved.size() != oldMoved.size())
+		return false;
 
-	summary.aDiffView		= cmpInfo.a.view;
-	summary.diffSections	= std::move(cmpInfo.blockDiffs);
+	for (size_t i = 0; i < moved.size(); ++i)
+	{
+		if (moved[i].s != oldMoved[i].s || moved[i].e != oldMoved[i].e)
+			return false;
+	}
 
-	PRINT_DIFFS("Patch diff sections:", summary.diffSections);
+	for (intptr_t l = lines.s; l < lines.e; ++l)
+	{
+		if (doc.isNonUnique(l) != old.nonUniqueLines[l - idxDelta])
+			return false;
+	}
 
-	return CompareResult::COMPARE_MISMATCH;
+	return true;
 }
 
 
-CompareResult runFindUnique(const CompareOptions& options, CompareSummary& summary)
+// Returns false if no block can be reused
+bool findReusedBlocks(const CompareInfo& cmpInfo, const CompareState& state, ReusedBlocks& reused)
 {
-	progress_ptr& progress = ProgressDlg::Get();
+	const DocCmpInfo* const docs[] = { &cmpInfo.a, &cmpInfo.b };
 
-	summary.clear();
-
-	DocCmpInfo a(MAIN_VIEW, &diff_info::a);
-	DocCmpInfo b(SUB_VIEW, &diff_info::b);
-
-	if (options.selectionCompare)
+	for (const DocCmpInfo* doc : docs)
 	{
-		a.range.s = options.selections[a.view].first;
-		a.range.e = options.selections[a.view].second + 1;
+		const CompareState::ViewState& old = state.views[doc->view];
 
-		b.range.s = options.selections[b.view].first;
-		b.range.e = options.selections[b.view].second + 1;
-	}
+		// The lines changed since the last compare are known only if the doc was not compared elsewhere meanwhile
+		if (doc->lines.empty() || old.comparedHashes.empty() || !doc->hashesPrevUse ||
+				doc->hashesPrevUse != old.hashesUse)
+			return false;
 
-	if (options.newFileViewId == a.view)
-	{
-		a.diffMask = MARKER_MASK_ADDED;
-		b.diffMask = MARKER_MASK_REMOVED;
-	}
-	else
-	{
-		a.diffMask = MARKER_MASK_REMOVED;
-		b.diffMask = MARKER_MASK_ADDED;
+		reused.idxDelta[doc->view]	= static_cast<intptr_t>(doc->lines.size() - old.comparedHashes.size());
+		reused.lineDelta[doc->view]	= doc->docLinesCount - old.linesCount;
+		reused.posDelta[doc->view]	= doc->docLen - old.docLen;
 	}
 
-	getLines(a, options);
+	const diff_results& diffs		= cmpInfo.blockDiffs;
+	const diff_results& oldDiffs	= state.lineDiffs;
 
-	progress->NextPhase();
+	const intptr_t diffsSize	= static_cast<intptr_t>(diffs.size());
+	const intptr_t oldDiffsSize	= static_cast<intptr_t>(oldDiffs.size());
+	const intptr_t maxCount		= std::min(diffsSize, oldDiffsSize);
 
-	getLines(b, options);
+	// Doc lines [startDocLine, endDocLine) hold the block's marks (bounded by the matching lines around if empty)
+	auto startDocLine =
+		[](const DocCmpInfo& doc, const range_t& lines)
+		{
+			return doc.getDocLine(lines.s);
+		};
 
-	progress->NextPhase();
+	auto endDocLine =
+		[](const DocCmpInfo& doc, const range_t& lines)
+		{
+			return lines.e ? doc.getDocLine(lines.e - 1) + 1 : 0;
+		};
 
-	std::unordered_map<Line::HashType, std::vector<intptr_t>> aUniqueLines;
+	auto isReused =
+		[&](intptr_t bi, intptr_t oldBi, bool atEnd)
+		{
+			for (const DocCmpInfo* doc : docs)
+			{
+				const range_t& lines	= doc->diffRange(diffs[bi]);
+				const range_t& oldLines	= doc->diffRange(oldDiffs[oldBi]);
+				const range_t& changed	= doc->changedDocLines;
+				const intptr_t idxDelta	= atEnd ? reused.idxDelta[doc->view] : 0;
 
-	for (const auto& line : a.lines)
-	{
-		auto insertPair = aUniqueLines.emplace(line.hash, std::vector<intptr_t>{line.num});
-		if (!insertPair.second)
-			insertPair.first->second.emplace_back(line.num);
-	}
+				if (lines.s != oldLines.s + idxDelta || lines.e != oldLines.e + idxDelta)
+					return false;
 
-	a.lines.clear();
+				if (changed.len() && (atEnd ?
+						startDocLine(*doc, lines) < changed.e : endDocLine(*doc, lines) > changed.s))
+					return false;
 
-	progress->NextPhase();
+				if (!sameBlockResults(*doc, bi, state.views[doc->view], oldBi, lines, idxDelta))
+					return false;
+			}
+
+			return true;
+		};
+
+	while (reused.startCount < maxCount && isReused(reused.startCount, reused.startCount, false))
+		++reused.startCount;
 
-	std::unordered_map<Line::HashType, std::vector<intptr_t>> bUniqueLines;
+	while (reused.endCount < maxCount - reused.startCount &&
+			isReused(diffsSize - reused.endCount - 1, oldDiffsSize - reused.endCount - 1, true))
+		++reused.endCount;
 
-	for (const auto& line : b.lines)
+	if (!reused.startCount && !reused.endCount)
+		return false;
+
+	for (const DocCmpInfo* doc : docs)
 	{
-		auto insertPair = bUniqueLines.emplace(line.hash, std::vector<intptr_t>{line.num});
-		if (!insertPair.second)
-			insertPair.first->second.emplace_back(line.num);
+		reused.docLines[doc->view].s = reused.startCount ?
+				endDocLine(*doc, doc->diffRange(diffs[reused.startCount - 1])) : 0;
+		reused.docLines[doc->view].e = reused.endCount ?
+				startDocLine(*doc, doc->diffRange(diffs[diffsSize - reused.endCount])) : doc->docLinesCount;
 	}
 
-	b.lines.clear();
-
-	progress->NextPhase();
+	LOGD(LOG_ALGO, "Reuse " + std::to_string(reused.startCount) + " start and " + std::to_string(reused.endCount) +
+			" end diffs of " + std::to_string(diffsSize) + ", re-mark A " +
+			reused.docLines[cmpInfo.a.view].to_string() + ", B " + reused.docLines[cmpInfo.b.view].to_string() + "\n");
 
-	clearWindow(MAIN_VIEW, false);
-	clearWindow(SUB_VIEW, false);
+	return true;
+}
 
-	intptr_t aUniqueLinesCount = 0;
 
-	for (const auto& uniqueLine : aUniqueLines)
+// Takes the marks and the alignment of the reused start blocks from the last compare
+void reuseStartMarks(CompareInfo& cmpInfo, const CompareState& state, const ReusedBlocks& reused,
+	AlignmentInfo_t& alignmentInfo)
+{
+	for (DocCmpInfo* doc : { &cmpInfo.a, &cmpInfo.b })
 	{
-		auto bItr = bUniqueLines.find(uniqueLine.first);
+		const ViewMarks& old	= state.views[doc->view].marks;
+		const intptr_t endLine	= reused.docLines[doc->view].s;
+		const intptr_t endPos	= getLineStart(doc->view, endLine);
 
-		if (bItr != bUniqueLines.end())
+		for (const auto& lm : old.lines)
 		{
-			bUniqueLines.erase(bItr);
-			++summary.match;
+			if (lm.s >= endLine)
+				break;
+
+			markLines(*doc, lm.s, std::min(lm.e, endLine), lm.mask);
 		}
-		else
+
+		for (const auto& tm : old.text)
 		{
-			for (const auto& line : uniqueLine.second)
-			{
-				markLine(a.view, line, a.diffMask);
-				++aUniqueLinesCount;
-			}
+			if (tm.pos >= endPos)
+				break;
+
+			doc->marks.text.push_back(tm);
 		}
 	}
 
-	if (aUniqueLinesCount == 0 && bUniqueLines.empty())
-		return CompareResult::COMPARE_MATCH;
+	alignmentInfo.append(state.alignmentInfo, 0,
+			state.alignmentInfo.idxAfter(&AlignmentPair::main, reused.docLines[cmpInfo.a.view].s), 0, 0);
+}
 
-	if (a.diffMask == MARKER_MASK_ADDED)
-		summary.added = aUniqueLinesCount;
-	else
-		summary.removed = aUniqueLinesCount;
 
-	for (const auto& uniqueLine : bUniqueLines)
+// Takes the marks and the alignment of the reused end blocks from the last compare shifting them by the changes
+void reuseEndMarks(CompareInfo& cmpInfo, const CompareState& state, const ReusedBlocks& reused,
+	AlignmentInfo_t& alignmentInfo)
+{
+	for (DocCmpInfo* doc : { &cmpInfo.a, &cmpInfo.b })
 	{
-		for (const auto& line : uniqueLine.second)
-			markLine(b.view, line, b.diffMask);
+		const ViewMarks& old		= state.views[doc->view].marks;
+		const intptr_t lineDelta	= reused.lineDelta[doc->view];
+		const intptr_t posDelta		= reused.posDelta[doc->view];
 
-		if (b.diffMask == MARKER_MASK_ADDED)
-			summary.added += uniqueLine.second.size();
-		else
-			summary.removed += uniqueLine.second.size();
-	}
+		// In the last compare's doc lines and positions
+		const intptr_t startLine	= reused.docLines[doc->view].e - lineDelta;
+		const intptr_t startPos		= getLineStart(doc->view, reused.docLines[doc->view].e) - posDelta;
 
-	summary.diffLines = summary.added + summary.removed;
+		for (auto lm = std::partition_point(old.lines.begin(), old.lines.end(),
+				[&](const ViewMarks::LinesMark& m) { return m.e <= startLine; }); lm != old.lines.end(); ++lm)
+			markLines(*doc, std::max(lm->s, startLine) + lineDelta, lm->e + lineDelta, lm->mask);
 
-	AlignmentPair align;
-	align.main.line	= a.range.s;
-	align.sub.line	= b.range.s;
+		for (auto tm = std::partition_point(old.text.begin(), old.text.end(),
+				[&](const ViewMarks::TextMark& m) { return m.pos < startPos; }); tm != old.text.end(); ++tm)
+			doc->marks.text.push_back({tm->pos + posDelta, tm->len, tm->color});
+	}
 
-	summary.alignmentInfo.push_back(align);
+	const int aView = cmpInfo.a.view;
+	const int bView = cmpInfo.b.view;
 
-	return CompareResult::COMPARE_MISMATCH;
-}
+	// Alignment pairs' main lines are 'a' doc lines. The closing pair is not taken - the lines before the last block
+	// diff might have changed.
+	alignmentInfo.append(state.alignmentInfo,
+			state.alignmentInfo.idxAfter(&AlignmentPair::main, reused.docLines[aView].e - reused.lineDelta[aView]),
+			state.alignmentInfo.size() - 1, reused.lineDelta[aView], reused.lineDelta[bView]);
 
+	alignDocsEnd(cmpInfo, alignmentInfo);
 }
 
 
-CompareResult compareViews(const CompareOptions& options, const wchar_t* progressInfo, CompareSummary& summary)
+// Keeps what the next incremental re-compare needs - the marks are moved in by compareViews() once shown
+void keepCompareState(CompareInfo& cmpInfo, const CompareSummary& summary, std::vector<intptr_t>&& changedCounts,
+	CompareState& state)
 {
-	CompareResult result = CompareResult::COMPARE_ERROR;
-
-	if (!progressInfo || !ProgressDlg::Open(progressInfo))
-		return CompareResult::COMPARE_ERROR;
-
-	clearChangedIndicatorFull(MAIN_VIEW);
-	clearChangedIndicatorFull(SUB_VIEW);
-
-	try
+	for (DocCmpInfo* doc : { &cmpInfo.a, &cmpInfo.b })
 	{
-		if (options.findUniqueMode)
-			result = runFindUnique(options, summary);
-		else
-			result = runCompare(options, summary);
+		CompareState::ViewState& vs = state.views[doc->view];
 
-		ProgressDlg::Close();
+		vs.nonUniqueLines = std::move(doc->nonUniqueLines);
+		vs.movedRanges.assign(doc->movedRanges.begin(), doc->movedRanges.end());
+		vs.marks.clear();
 
-		if (result != CompareResult::COMPARE_MISMATCH)
-		{
-			clearWindow(MAIN_VIEW);
-			clearWindow(SUB_VIEW);
-		}
+		vs.linesCount	= doc->docLinesCount;
+		vs.docLen		= doc->docLen;
+		vs.hashesUse	= doc->hashesUse;
 	}
-	catch (const std::exception& e)
-	{
-		ProgressDlg::Close();
 
-		clearWindow(MAIN_VIEW);
+	state.lineDiffs		= cmpInfo.blockDiffs;
+	state.changedCounts	= std::move(changedCounts);
+	state.alignmentInfo	= summary.alignmentInfo;	// Shared until the summary's one is adjusted to the edits
+	state.valid			= true;
+}
+
+
+void toDocLineDiffSections(CompareInfo& cmpInfo)
+{
+	DocCmpInfo&	a = cmpInfo.a;
+	DocCmpInfo&	b = cmpInfo.b;
+
+	for (auto& bd : cmpInfo.blockDiffs)
+	{
+		bd.a.s = a.getDocLine(bd.a.s);
+		bd.a.e = a.getDocLine(bd.a.e);
+		bd.b.s = b.getDocLine(bd.b.s);
+		bd.b.e = b.getDocLine(bd.b.e);
+	}
+}
+
+
+CompareResult runCompare(const CompareOptions& options, CompareSummary& summary, CompareState* state)
+{
+	progress_ptr& progress = ProgressDlg::Get();
+
+	summary.clear();
+
+	CompareInfo cmpInfo;
+
+	if (options.selectionCompare)
+	{
+		cmpInfo.a.range.s = options.selections[cmpInfo.a.view].first;
+		cmpInfo.a.range.e = options.selections[cmpInfo.a.view].second + 1;
+
+		cmpInfo.b.range.s = options.selections[cmpInfo.b.view].first;
+		cmpInfo.b.range.e = options.selections[cmpInfo.b.view].second + 1;
+	}
+
+	cmpInfo.a.diffMask = (options.newFileViewId == cmpInfo.a.view) ? MARKER_MASK_ADDED : MARKER_MASK_REMOVED;
+	cmpInfo.b.diffMask = (options.newFileViewId == cmpInfo.a.view) ? MARKER_MASK_REMOVED : MARKER_MASK_ADDED;
+
+	LOGD_GET_TIME;
+
+	getLines(cmpInfo.a, cmpInfo.b, options);
+
+	// The line diff runs on the dense line class IDs instead of the 64-bit hashes
+	internLines(cmpInfo.a, cmpInfo.b);
+
+	progress->NextPhase();
+	progress->NextPhase();
+
+	// The last compare results are reused only by this compare - if it fails or is cancelled none are left
+	const bool lastValid = (state && state->valid);
+
+	if (state)
+		state->marksReused = state->valid = false;
+
+	// The line diffs are always full - diffing only a window around the changes does not give the same results.
+	// Sync points split the diffs in fixed parts - the same lines might not give the same diffs then.
+	if (lastValid && options.syncPoints.empty() && sameComparedLines(cmpInfo, *state))
+	{
+		cmpInfo.blockDiffs = state->lineDiffs;
+	}
+	else
+	{
+		DiffCalc<LineId> lineDiffCalc(cmpInfo.a.lineIds, cmpInfo.b.lineIds,
+				std::bind(&ProgressDlg::ThrowIfCancelled, progress), nullptr, options.fastApproxDiff);
+
+		cmpInfo.blockDiffs = lineDiffCalc(options.lineDiffAlg,
+				options.ignoreAllSpaces || options.ignoreChangedSpaces, true, options.syncPoints);
+
+		LOGD(LOG_ALGO, std::string("Line diff algorithm ") + diff_alg_name(lineDiffCalc.selected_alg()) +
+				(lineDiffCalc.selected_bounded() ? " (bounded)\n" : "\n"));
+
+		if (state)
+		{
+			for (const DocCmpInfo* doc : { &cmpInfo.a, &cmpInfo.b })
+			{
+				std::vector<uint64_t>& hashes = state->views[doc->view].comparedHashes;
+
+				hashes.resize(doc->lines.size());
+
+				for (size_t i = 0; i < doc->lines.size(); ++i)
+					hashes[i] = doc->lines[i].hash;
+
+				state->views[doc->view].comparedFingerprint = doc->linesFingerprint;
+			}
+		}
+	}
+
+	LOGD_GET_TIME;
+	PRINT_DIFFS("COMPARE START - LINE DIFFS", cmpInfo.blockDiffs);
+
+	if (cmpInfo.blockDiffs.empty())
+		return CompareResult::COMPARE_MATCH;
+
+	const intptr_t blockDiffsSize = static_cast<intptr_t>(cmpInfo.blockDiffs.size());
+
+	cmpInfo.a.changedLines.resize(blockDiffsSize);
+	cmpInfo.b.changedLines.resize(blockDiffsSize);
+	cmpInfo.a.movedRanges.resize(blockDiffsSize);
+	cmpInfo.b.movedRanges.resize(blockDiffsSize);
+
+	findUniqueLines(cmpInfo);
+
+	// The last compare's marks are on screen - showing the partial results over them would only flicker
+	if (!lastValid)
+		showCompareStage(cmpInfo, options);
+
+	if (options.detectMoves)
+	{
+		findMoves(cmpInfo);
+
+		if (!lastValid)
+			showCompareStage(cmpInfo, options);
+	}
+
+	progress->NextPhase();
+
+	ReusedBlocks reused;
+
+	// The compared range of a selection compare is not tracked through the changes
+	const bool reuse = lastValid && !options.selectionCompare && findReusedBlocks(cmpInfo, *state, reused);
+
+	const intptr_t startBlock	= reuse ? reused.startCount : 0;
+	const intptr_t endBlock		= reuse ? blockDiffsSize - reused.endCount : blockDiffsSize;
+
+	if (options.detectSubBlockDiffs)
+		findSubBlockDiffs(cmpInfo, options, startBlock, endBlock);
+
+	progress->NextPhase();
+
+	// Make sure we have at least one line in each view so the functions' logic below works properly
+	if (cmpInfo.a.lines.empty())
+		cmpInfo.a.lines.emplace_back(0, cHashSeed);
+	if (cmpInfo.b.lines.empty())
+		cmpInfo.b.lines.emplace_back(0, cHashSeed);
+
+	std::vector<intptr_t> changedCounts(blockDiffsSize);
+
+	if (reuse)
+		reuseStartMarks(cmpInfo, *state, reused, summary.alignmentInfo);
+
+	markDiffs(cmpInfo, options, summary.alignmentInfo, startBlock, endBlock);
+
+	for (intptr_t bi = startBlock; bi < endBlock; ++bi)
+		changedCounts[bi] = static_cast<intptr_t>(cmpInfo.a.changedLines[bi].size());
+
+	if (reuse)
+	{
+		// markDiffs() has closed the alignment at the docs' end then
+		if (reused.endCount)
+			reuseEndMarks(cmpInfo, *state, reused, summary.alignmentInfo);
+
+		const intptr_t oldDiffsSize = static_cast<intptr_t>(state->lineDiffs.size());
+
+		for (intptr_t bi = 0; bi < startBlock; ++bi)
+			changedCounts[bi] = state->changedCounts[bi];
+
+		for (intptr_t bi = endBlock; bi < blockDiffsSize; ++bi)
+			changedCounts[bi] = state->changedCounts[bi - blockDiffsSize + oldDiffsSize];
+	}
+
+	countDiffs(cmpInfo, changedCounts, summary);
+
+	summary.marks[cmpInfo.a.view] = std::move(cmpInfo.a.marks);
+	summary.marks[cmpInfo.b.view] = std::move(cmpInfo.b.marks);
+
+	if (state)
+	{
+		keepCompareState(cmpInfo, summary, std::move(changedCounts), *state);
+
+		state->views[cmpInfo.a.view].updatedLines = reused.docLines[cmpInfo.a.view];
+		state->views[cmpInfo.b.view].updatedLines = reused.docLines[cmpInfo.b.view];
+		state->marksReused = reuse;
+	}
+
+	progress->NextPhase();
+
+	toDocLineDiffSections(cmpInfo);
+
+	summary.aDiffView		= cmpInfo.a.view;
+	summary.diffSections	= std::move(cmpInfo.blockDiffs);
+
+	PRINT_DIFFS("Patch diff sections:", summary.diffSections);
+
+	return CompareResult::COMPARE_MISMATCH;
+}
+
+
+CompareResult runFindUnique(const CompareOptions& options, CompareSummary& summary)
+{
+	progress_ptr& progress = ProgressDlg::Get();
+
+	summary.clear();
+
+	DocCmpInfo a(MAIN_VIEW, &diff_info::a);
+	DocCmpInfo b(SUB_VIEW, &diff_info::b);
+
+	if (options.selectionCompare)
+	{
+		a.range.s = options.selections[a.view].first;
+		a.range.e = options.selections[a.view].second + 1;
+
+		b.range.s = options.selections[b.view].first;
+		b.range.e = options.selections[b.view].second + 1;
+	}
+
+	if (options.newFileViewId == a.view)
+	{
+		a.diffMask = MARKER_MASK_ADDED;
+		b.diffMask = MARKER_MASK_REMOVED;
+	}
+	else
+	{
+		a.diffMask = MARKER_MASK_REMOVED;
+		b.diffMask = MARKER_MASK_ADDED;
+	}
+
+	getLines(a, b, options);
+
+	progress->NextPhase();
+	progress->NextPhase();
+
+	internLines(a, b);
+
+	progress->NextPhase();
+	progress->NextPhase();
+
+	// Line class is matched if present in both docs
+	for (size_t id = 0; id < a.classCount.size(); ++id)
+	{
+		if (a.classCount[id] && b.classCount[id])
+			++summary.match;
+	}
+
+	auto markUniqueLines =
+		[](DocCmpInfo& doc, const DocCmpInfo& otherDoc)
+		{
+			intptr_t uniqueLinesCount = 0;
+
+			for (size_t i = 0; i < doc.lines.size(); ++i)
+			{
+				if (otherDoc.classCount[doc.lineIds[i].hash] == 0)
+				{
+					markLine(doc, doc.lines[i].num, doc.diffMask);
+					++uniqueLinesCount;
+				}
+			}
+
+			return uniqueLinesCount;
+		};
+
+	const intptr_t aUniqueLinesCount = markUniqueLines(a, b);
+	const intptr_t bUniqueLinesCount = markUniqueLines(b, a);
+
+	summary.marks[a.view] = std::move(a.marks);
+	summary.marks[b.view] = std::move(b.marks);
+
+	if (aUniqueLinesCount == 0 && bUniqueLinesCount == 0)
+		return CompareResult::COMPARE_MATCH;
+
+	if (a.diffMask == MARKER_MASK_ADDED)
+	{
+		summary.added	= aUniqueLinesCount;
+		summary.removed	= bUniqueLinesCount;
+	}
+	else
+	{
+		summary.added	= bUniqueLinesCount;
+		summary.removed	= aUniqueLinesCount;
+	}
+
+	summary.diffLines = summary.added + summary.removed;
+
+	AlignmentPair align;
+	align.main.line	= a.range.s;
+	align.sub.line	= b.range.s;
+
+	summary.alignmentInfo.emplace_back(align);
+
+	return CompareResult::COMPARE_MISMATCH;
+}
+
+}
+
+
+void AlignmentInfo_t::_appendRun(const AlignmentPair& first, intptr_t len)
+{
+	std::vector<AlignmentRun>& runs = _ownRuns();
+
+	if (!runs.empty())
+	{
+		AlignmentRun& last = runs.back();
+
+		if (last.first.main.diffMask == first.main.diffMask && last.first.sub.diffMask == first.sub.diffMask &&
+			last.first.main.line + last.len == first.main.line &&
+			last.first.sub.line + last.len == first.sub.line)
+		{
+			last.len += len;
+			_size += len;
+			return;
+		}
+	}
+
+	runs.push_back({first, _size, len});
+	_size += len;
+}
+
+
+std::vector<AlignmentInfo_t::AlignmentRun>& AlignmentInfo_t::_ownRuns()
+{
+	if (_runs.use_count() > 1)
+		_runs = std::make_shared<std::vector<AlignmentRun>>(*_runs);
+
+	return *_runs;
+}
+
+
+void AlignmentInfo_t::emplace_back(const AlignmentPair& alignPair)
+{
+	_appendRun(alignPair, 1);
+}
+
+
+size_t AlignmentInfo_t::_findRun(intptr_t idx) const
+{
+	const std::vector<AlignmentRun>& runs = *_runs;
+	const size_t runsCount = runs.size();
+
+	if (_lastRun < runsCount)
+	{
+		if (idx >= runs[_lastRun].idx && idx < runs[_lastRun].idx + runs[_lastRun].len)
+			return _lastRun;
+
+		if (_lastRun + 1 < runsCount && idx >= runs[_lastRun + 1].idx &&
+				idx < runs[_lastRun + 1].idx + runs[_lastRun + 1].len)
+			return ++_lastRun;
+	}
+
+	auto run = std::upper_bound(runs.begin(), runs.end(), idx,
+			[](intptr_t i, const AlignmentRun& r) { return i < r.idx; });
+
+	_lastRun = static_cast<size_t>(run - runs.begin()) - 1;
+
+	return _lastRun;
+}
+
+
+AlignmentPair AlignmentInfo_t::operator[](intptr_t idx) const
+{
+	const AlignmentRun& run = (*_runs)[_findRun(idx)];
+	const intptr_t off = idx - run.idx;
+
+	AlignmentPair alignPair = run.first;
+
+	alignPair.main.line	+= off;
+	alignPair.sub.line	+= off;
+
+	return alignPair;
+}
+
+
+intptr_t AlignmentInfo_t::idxAfter(const AlignmentViewData AlignmentPair::*pView, intptr_t line) const
+{
+	// First run whose last line is not less than line
+	auto run = std::partition_point(_runs->begin(), _runs->end(),
+			[&](const AlignmentRun& r) { return (r.first.*pView).line + r.len - 1 < line; });
+
+	if (run == _runs->end())
+		return _size;
+
+	const intptr_t off = line - (run->first.*pView).line;
+
+	return run->idx + (off > 0 ? off : 0);
+}
+
+
+size_t AlignmentInfo_t::_splitAt(intptr_t idx)
+{
+	std::vector<AlignmentRun>& runs = _ownRuns();
+
+	if (idx >= _size)
+		return runs.size();
+
+	const size_t ri = _findRun(idx);
+	const intptr_t off = idx - runs[ri].idx;
+
+	if (off == 0)
+		return ri;
+
+	AlignmentRun tail = runs[ri];
+
+	tail.first.main.line	+= off;
+	tail.first.sub.line		+= off;
+	tail.idx				+= off;
+	tail.len				-= off;
+
+	runs[ri].len = off;
+	runs.insert(runs.begin() + ri + 1, tail);
+
+	return ri + 1;
+}
+
+
+void AlignmentInfo_t::erase(intptr_t startIdx, intptr_t endIdx)
+{
+	if (endIdx > _size)
+		endIdx = _size;
+
+	if (startIdx >= endIdx)
+		return;
+
+	std::vector<AlignmentRun>& runs = _ownRuns();
+
+	_splitAt(endIdx);
+
+	auto first	= runs.begin() + _splitAt(startIdx);
+	auto last	= std::lower_bound(first, runs.end(), endIdx,
+			[](const AlignmentRun& r, intptr_t i) { return r.idx < i; });
+
+	const intptr_t erased = endIdx - startIdx;
+
+	for (auto it = runs.erase(first, last); it != runs.end(); ++it)
+		it->idx -= erased;
+
+	_size -= erased;
+	_lastRun = 0;
+}
+
+
+void AlignmentInfo_t::shiftLines(AlignmentViewData AlignmentPair::*pView, intptr_t startIdx, intptr_t offset)
+{
+	std::vector<AlignmentRun>& runs = _ownRuns();
+
+	for (size_t ri = _splitAt(startIdx); ri < runs.size(); ++ri)
+		(runs[ri].first.*pView).line += offset;
+}
+
+
+void AlignmentInfo_t::append(const AlignmentInfo_t& other, intptr_t startIdx, intptr_t endIdx, intptr_t mainOffset,
+	intptr_t subOffset)
+{
+	if (endIdx > other._size)
+		endIdx = other._size;
+
+	if (startIdx >= endIdx)
+		return;
+
+	const std::vector<AlignmentRun>& otherRuns = *other._runs;
+
+	for (size_t ri = other._findRun(startIdx); ri < otherRuns.size() && otherRuns[ri].idx < endIdx; ++ri)
+	{
+		const AlignmentRun& run = otherRuns[ri];
+		const intptr_t off = (startIdx > run.idx) ? startIdx - run.idx : 0;
+
+		AlignmentPair first = run.first;
+
+		first.main.line	+= off + mainOffset;
+		first.sub.line	+= off + subOffset;
+
+		_appendRun(first, std::min(run.idx + run.len, endIdx) - run.idx - off);
+	}
+}
+
+
+void onDocTextChanged(intptr_t sciDoc, intptr_t line, intptr_t linesAdded, intptr_t lenAdded)
+{
+#ifdef MULTITHREAD
+	++docsTextChanges;
+
+	std::unique_lock<std::mutex> hashesLock(docsLineHashesMutex, std::try_to_lock);
+
+	if (!hashesLock.owns_lock())
+	{
+		docsLineHashesStale = true;
+		return;
+	}
+#endif
+
+	auto found = docsLineHashes.find(sciDoc);
+
+	if (found == docsLineHashes.end())
+		return;
+
+	DocLineHashes& dlh = found->second;
+
+	dlh.docLen += lenAdded;
+
+	// Out of sync - line hashes will be reset on next compare
+	if (line < 0 || line >= dlh.linesCount || line - linesAdded >= dlh.linesCount)
+	{
+		dlh.linesCount = -1;
+		return;
+	}
+
+	dlh.linesCount += linesAdded;
+
+	for (int i = 0; i < cLineHashVariants; ++i)
+	{
+		std::vector<uint64_t>& hashes = dlh.hashes[i];
+		std::vector<uint8_t>& info = dlh.info[i];
+
+		if (info.empty())
+			continue;
+
+		if (linesAdded > 0)
+		{
+			hashes.insert(hashes.begin() + line + 1, linesAdded, 0);
+			info.insert(info.begin() + line + 1, linesAdded, LINE_CHANGED);
+		}
+		else if (linesAdded < 0)
+		{
+			hashes.erase(hashes.begin() + line + 1, hashes.begin() + line + 1 - linesAdded);
+			info.erase(info.begin() + line + 1, info.begin() + line + 1 - linesAdded);
+		}
+
+		info[line] = LINE_CHANGED;
+	}
+}
+
+
+void dropDocLineHashes(LRESULT buffId)
+{
+#ifdef MULTITHREAD
+	std::unique_lock<std::mutex> hashesLock(docsLineHashesMutex, std::try_to_lock);
+
+	if (!hashesLock.owns_lock())
+	{
+		docsLineHashesStale = true;
+		return;
+	}
+#endif
+
+	for (auto it = docsLineHashes.begin(); it != docsLineHashes.end(); ++it)
+	{
+		if (it->second.buffId == buffId)
+		{
+			docsLineHashes.erase(it);
+			return;
+		}
+	}
+}
+
+
+void stopCompareWorkers()
+{
+#ifdef MULTITHREAD
+	TaskPool::Get().Stop();
+#endif
+}
+
+
+#ifdef MULTITHREAD
+
+// Lets the user scroll the compared views by mouse wheel and the navigation keys while the compare runs.
+// The compare reads the docs so nothing that might change them is allowed.
+bool isCompareScrollInput(const MSG& msg)
+{
+	if (msg.hwnd != nppData._scintillaMainHandle && msg.hwnd != nppData._scintillaSecondHandle)
+		return false;
+
+	// Ctrl + wheel zooms
+	if (msg.message == WM_MOUSEWHEEL || msg.message == WM_MOUSEHWHEEL)
+		return !(GET_KEYSTATE_WPARAM(msg.wParam) & MK_CONTROL);
+
+	if (msg.message != WM_KEYDOWN && msg.message != WM_KEYUP)
+		return false;
+
+	// Shortcuts might edit (moving lines for example)
+	if (::GetKeyState(VK_CONTROL) < 0 || ::GetKeyState(VK_MENU) < 0)
+		return false;
+
+	switch (msg.wParam)
+	{
+		case VK_PRIOR:
+		case VK_NEXT:
+		case VK_END:
+		case VK_HOME:
+		case VK_LEFT:
+		case VK_UP:
+		case VK_RIGHT:
+		case VK_DOWN:
+			return true;
+	}
+
+	return false;
+}
+
+
+// The message the compare worker waits the GUI thread to send for it - see sendFromCompareWorker()
+struct CompareWorkerCall
+{
+	HANDLE	requestEvent {NULL};
+	HANDLE	doneEvent {NULL};
+
+	HWND	hwnd {NULL};
+	UINT	msg {0};
+	WPARAM	wParam {0};
+	LPARAM	lParam {0};
+	LRESULT	result {0};
+};
+
+// Set only while the compare runs on the worker thread
+CompareWorkerCall* compareWorkerCall = nullptr;
+
+
+// Refuses the messages sent by other threads (other plugins, another Notepad++ instance by WM_COPYDATA) that might
+// switch, close or edit the compared docs while the compare reads them. The system's ones are passed on.
+LRESULT CALLBACK compareGuardProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR, DWORD_PTR)
+{
+	if (::InSendMessage())
+	{
+		switch (uMsg)
+		{
+			case WM_CLOSE:
+			case WM_SETTEXT:
+			case WM_COPYDATA:
+			case WM_COMMAND:
+			case WM_CHAR:
+			case WM_CUT:
+			case WM_PASTE:
+			case WM_CLEAR:
+			case WM_UNDO:
+				return 0;
+		}
+
+		// Notepad++ and Scintilla messages
+		if (uMsg >= WM_USER)
+			return 0;
+	}
+
+	return ::DefSubclassProc(hwnd, uMsg, wParam, lParam);
+}
+
+
+void guardCompareWindows(bool guard)
+{
+	const HWND guarded[] = { nppData._nppHandle, nppData._scintillaMainHandle, nppData._scintillaSecondHandle };
+
+	for (HWND hwnd : guarded)
+	{
+		if (guard)
+			::SetWindowSubclass(hwnd, compareGuardProc, 0, 0);
+		else
+			::RemoveWindowSubclass(hwnd, compareGuardProc, 0);
+	}
+}
+
+
+// Drops the user input to Notepad++ that came while the compare was running - as if Notepad++ was disabled meanwhile
+void dropCompareInput()
+{
+	MSG msg;
+
+	while (::PeekMessageW(&msg, NULL, WM_KEYFIRST, WM_KEYLAST, PM_REMOVE) ||
+			::PeekMessageW(&msg, NULL, WM_MOUSEFIRST, WM_MOUSELAST, PM_REMOVE) ||
+			::PeekMessageW(&msg, NULL, WM_NCMOUSEMOVE, WM_NCXBUTTONDBLCLK, PM_REMOVE));
+}
+
+
+LRESULT sendFromCompareWorker(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	CompareWorkerCall& call = *compareWorkerCall;
+
+	call.hwnd	= hwnd;
+	call.msg	= uMsg;
+	call.wParam	= wParam;
+	call.lParam	= lParam;
+
+	::SetEvent(call.requestEvent);
+	::WaitForSingleObject(call.doneEvent, INFINITE);
+
+	return call.result;
+}
+
+
+// Runs the compare on a worker thread so the GUI thread stays responsive - it keeps Notepad++ painted, serves the
+// worker's Scintilla calls, lets the user scroll and shows the diffs found so far (see showCompareStage()).
+// Notepad++ is not disabled by the progress dialog but its input is dropped except for scrolling. The messages
+// other threads send meanwhile are served (the compare might be waiting for them) but those that could change the
+// compared docs are refused. Should a doc still change, the compare is cancelled.
+CompareResult runOnCompareWorker(const std::function<CompareResult()>& compareFunc)
+{
+	// The diffs found so far are shown only if the compare takes longer - avoids flicker on quick compares
+	constexpr DWORD cStageShowDelay_ms = 300;
+
+	CompareResult result = CompareResult::COMPARE_ERROR;
+	std::exception_ptr error;
+
+	CompareStage stage;
+	CompareWorkerCall call;
+
+	// Compare done, stage ready and worker call events
+	HANDLE events[3] = { ::CreateEventW(NULL, TRUE, FALSE, NULL), ::CreateEventW(NULL, FALSE, FALSE, NULL),
+			::CreateEventW(NULL, FALSE, FALSE, NULL) };
+
+	call.requestEvent	= events[2];
+	call.doneEvent		= ::CreateEventW(NULL, FALSE, FALSE, NULL);
+
+	const intptr_t docIds[2]	= { getDocId(MAIN_VIEW), getDocId(SUB_VIEW) };
+	const size_t textChanges	= docsTextChanges;
+
+	if (!events[0] || !events[1] || !events[2] || !call.doneEvent)
+	{
+		try
+		{
+			result = compareFunc();
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+	}
+	else
+	{
+		stage.readyEvent = events[1];
+		compareStage = &stage;
+		compareWorkerCall = &call;
+
+		guardCompareWindows(true);
+
+		std::thread worker(
+			[&]()
+			{
+				sciCallsMarshaled = true;
+
+				try
+				{
+					result = compareFunc();
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+
+				::SetEvent(events[0]);
+			});
+
+		const DWORD startTime_ms = ::GetTickCount();
+
+		for (;;)
+		{
+			MSG msg;
+
+			// The other input is dropped and the timers wait for the compare to finish
+			while (::PeekMessageW(&msg, NULL, WM_PAINT, WM_PAINT, PM_REMOVE) ||
+					::PeekMessageW(&msg, NULL, WM_MOUSEWHEEL, WM_MOUSEWHEEL, PM_REMOVE) ||
+					::PeekMessageW(&msg, NULL, WM_MOUSEHWHEEL, WM_MOUSEHWHEEL, PM_REMOVE) ||
+					::PeekMessageW(&msg, NULL, WM_KEYFIRST, WM_KEYLAST, PM_REMOVE))
+			{
+				if (msg.message == WM_PAINT || isCompareScrollInput(msg))
+					::DispatchMessageW(&msg);
+			}
+
+			const DWORD elapsed_ms = ::GetTickCount() - startTime_ms;
+
+			if (elapsed_ms >= cStageShowDelay_ms)
+			{
+				ViewMarks marks[2];
+				bool ready = false;
+
+				{
+					std::lock_guard<std::mutex> lock(stage.mutex);
+
+					if (stage.ready)
+					{
+						marks[MAIN_VIEW]	= std::move(stage.marks[MAIN_VIEW]);
+						marks[SUB_VIEW]		= std::move(stage.marks[SUB_VIEW]);
+						stage.ready			= false;
+						ready				= true;
+					}
+				}
+
+				if (ready)
+				{
+					applyViewMarks(MAIN_VIEW, marks[MAIN_VIEW]);
+					applyViewMarks(SUB_VIEW, marks[SUB_VIEW]);
+				}
+			}
+
+			const DWORD timeout_ms = (elapsed_ms < cStageShowDelay_ms) ? cStageShowDelay_ms - elapsed_ms : INFINITE;
+
+			const DWORD waitRes = ::MsgWaitForMultipleObjects(3, events, FALSE, timeout_ms,
+					QS_SENDMESSAGE | QS_PAINT | QS_KEY | QS_MOUSEBUTTON);
+
+			if (waitRes == WAIT_OBJECT_0)
+				break;
+
+			if (waitRes == WAIT_OBJECT_0 + 2)
+			{
+				call.result = ::SendMessageW(call.hwnd, call.msg, call.wParam, call.lParam);
+				::SetEvent(call.doneEvent);
+			}
+		}
+
+		worker.join();
+
+		guardCompareWindows(false);
+
+		compareWorkerCall = nullptr;
+		compareStage = nullptr;
+	}
+
+	for (HANDLE e : events)
+	{
+		if (e)
+			::CloseHandle(e);
+	}
+
+	if (call.doneEvent)
+		::CloseHandle(call.doneEvent);
+
+	dropCompareInput();
+
+	if (error)
+		std::rethrow_exception(error);
+
+	// Served messages might still have switched or edited a compared doc - its results are not valid anymore
+	if (docIds[MAIN_VIEW] != getDocId(MAIN_VIEW) || docIds[SUB_VIEW] != getDocId(SUB_VIEW) ||
+			textChanges != docsTextChanges)
+		throw std::runtime_error(ProgressDlg::cCancelledCause);
+
+	return result;
+}
+
+#endif // MULTITHREAD
+
+
+CompareResult compareViews(const CompareOptions& options, const wchar_t* progressInfo, CompareSummary& summary,
+	CompareState* state)
+{
+	CompareResult result = CompareResult::COMPARE_ERROR;
+
+#ifdef MULTITHREAD
+	// Notepad++ input is filtered by runOnCompareWorker() so the user can scroll the compared views meanwhile
+	constexpr bool lockNpp = false;
+#else
+	constexpr bool lockNpp = true;
+#endif
+
+	if (!progressInfo || !ProgressDlg::Open(progressInfo, lockNpp))
+		return CompareResult::COMPARE_ERROR;
+
+#ifdef DLOG
+	const size_t sciCallsStart = dLogSciCalls;
+#endif
+
+	try
+	{
+		// The compare only reads the views - its final results are rendered in them after that
+#ifdef MULTITHREAD
+		result = runOnCompareWorker(
+			[&]()
+			{
+				return options.findUniqueMode ? runFindUnique(options, summary) : runCompare(options, summary, state);
+			});
+#else
+		if (options.findUniqueMode)
+			result = runFindUnique(options, summary);
+		else
+			result = runCompare(options, summary, state);
+#endif
+
+		if (result == CompareResult::COMPARE_MISMATCH)
+		{
+			// The marks outside the updated lines are the last compare's ones - already on screen
+			const bool marksReused = (state && state->marksReused);
+
+			applyViewMarks(MAIN_VIEW, summary.marks[MAIN_VIEW],
+					marksReused ? &state->views[MAIN_VIEW].updatedLines : nullptr);
+			applyViewMarks(SUB_VIEW, summary.marks[SUB_VIEW],
+					marksReused ? &state->views[SUB_VIEW].updatedLines : nullptr);
+
+			// The next incremental re-compare takes the unchanged parts' marks from those
+			if (state && state->valid && !options.findUniqueMode)
+			{
+				state->views[MAIN_VIEW].marks	= std::move(summary.marks[MAIN_VIEW]);
+				state->views[SUB_VIEW].marks	= std::move(summary.marks[SUB_VIEW]);
+			}
+		}
+
+		LOGD(LOG_ALGO, "Compare done, Scintilla messages sent: " + std::to_string(dLogSciCalls - sciCallsStart) +
+				"\n");
+
+		ProgressDlg::Close();
+
+		if (result != CompareResult::COMPARE_MISMATCH)
+		{
+			clearWindow(MAIN_VIEW);
+			clearWindow(SUB_VIEW);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		ProgressDlg::Close();
+
+		clearWindow(MAIN_VIEW);
 		clearWindow(SUB_VIEW);
 
+		if (state)
+			state->clear();
+
 		if (e.what() == ProgressDlg::cCancelledCause)
 			return CompareResult::COMPARE_CANCELLED;
 
@@ -2544,6 +4315,9 @@ CompareResult compareViews(const CompareOptions& options, const wchar_t* progres
 	{
 		ProgressDlg::Close();
 
+		if (state)
+			state->clear();
+
 		::MessageBoxA(nppData._nppHandle, "Unknown exception occurred.", "ComparePlus", MB_OK | MB_ICONWARNING);
 	}
 
@@ -105,6 +105,16 @@ struct CompareOptions
 
 	int		changedResemblPercent;
 
+	// Bounded cost (faster) but possibly not minimal diffs of much different texts
+	bool	fastApproxDiff;
+
+	// Lines longer than that (in bytes) are compared by tokens only, chars are compared just in small windows.
+	// 0 - no limit.
+	intptr_t	longLineLen;
+
+	// Lines diff algorithm - MIXED (histogram refined by Myers), PATIENCE or AUTO (picked per compare)
+	DiffAlg		lineDiffAlg;
+
 	bool	selectionCompare;
 
 	std::pair<intptr_t, intptr_t>	selections[2];
@@ -125,7 +135,117 @@ struct AlignmentPair
 };
 
 
-using AlignmentInfo_t = std::vector<AlignmentPair>;
+/**
+ *  \class  AlignmentInfo_t
+ *  \brief  Pairs of lines (one per view) that shall be aligned. Kept as runs of pairs with both lines increasing by 1
+ *          and the same diff masks so the matching parts of the files take almost no memory - the memory scales with
+ *          the diffs count, not with the lines count. Accessed by pair index as a plain AlignmentPair vector would be
+ *          (O(1) on sequential access, O(log(runs)) otherwise).
+ */
+class AlignmentInfo_t
+{
+public:
+	AlignmentInfo_t() = default;
+
+	// Copies share the runs until either is changed (moves are copies then) - the kept compare state and the summary
+	// hold the same alignment that way
+	AlignmentInfo_t(const AlignmentInfo_t&) = default;
+	AlignmentInfo_t& operator=(const AlignmentInfo_t&) = default;
+
+	intptr_t size() const { return _size; };
+	bool empty() const { return (_size == 0); };
+
+	inline void clear()
+	{
+		if (_runs.use_count() > 1)
+			_runs = std::make_shared<std::vector<AlignmentRun>>();
+		else
+			_runs->clear();
+
+		_size = 0;
+		_lastRun = 0;
+	}
+
+	// Appends the pair - it is glued to the last run if it continues it
+	void emplace_back(const AlignmentPair& alignPair);
+
+	AlignmentPair operator[](intptr_t idx) const;
+
+	// Index of the first pair whose pView line is not less than line (size() if none) - the pairs' lines are ordered
+	intptr_t idxAfter(const AlignmentViewData AlignmentPair::*pView, intptr_t line) const;
+
+	// Removes pairs [startIdx, endIdx)
+	void erase(intptr_t startIdx, intptr_t endIdx);
+
+	// Adds offset to the pView lines of all pairs from startIdx on
+	void shiftLines(AlignmentViewData AlignmentPair::*pView, intptr_t startIdx, intptr_t offset);
+
+	// Appends pairs [startIdx, endIdx) of other with mainOffset and subOffset added to their lines
+	void append(const AlignmentInfo_t& other, intptr_t startIdx, intptr_t endIdx, intptr_t mainOffset,
+			intptr_t subOffset);
+
+	intptr_t runsCount() const { return static_cast<intptr_t>(_runs->size()); };
+
+private:
+	struct AlignmentRun
+	{
+		AlignmentPair	first;	// The run's first pair
+		intptr_t		idx;	// The first pair index
+		intptr_t		len;	// Pairs count
+	};
+
+	// Index of the run containing pair idx
+	size_t _findRun(intptr_t idx) const;
+
+	// Splits the run containing pair idx so that a run starts at it - returns that run's index (runs count if none)
+	size_t _splitAt(intptr_t idx);
+
+	// Appends len pairs starting with first - they are glued to the last run if they continue it
+	void _appendRun(const AlignmentPair& first, intptr_t len);
+
+	// The runs to be changed - copied first if shared
+	std::vector<AlignmentRun>& _ownRuns();
+
+	std::shared_ptr<std::vector<AlignmentRun>>	_runs {std::make_shared<std::vector<AlignmentRun>>()};
+	intptr_t									_size {0};
+
+	// Last accessed run - makes the sequential access O(1)
+	mutable size_t								_lastRun {0};
+};
+
+
+/**
+ *  \struct
+ *  \brief  Compare result marks of a view - what the compare sets in the view (line markers and text highlights).
+ *          The compare only collects them, they are rendered in the view at once after that.
+ */
+struct ViewMarks
+{
+	// Doc lines [s, e) marked with the same marker mask
+	struct LinesMark
+	{
+		intptr_t	s;
+		intptr_t	e;
+		int			mask;
+	};
+
+	// Highlighted (changed or ignored) text
+	struct TextMark
+	{
+		intptr_t	pos;
+		intptr_t	len;
+		int			color;
+	};
+
+	inline void clear()
+	{
+		lines.clear();
+		text.clear();
+	}
+
+	std::vector<LinesMark>	lines;
+	std::vector<TextMark>	text;
+};
 
 
 struct CompareSummary
@@ -141,6 +261,9 @@ struct CompareSummary
 
 		alignmentInfo.clear();
 		diffSections.clear();
+
+		marks[0].clear();
+		marks[1].clear();
 	}
 
 	intptr_t	diffLines;
@@ -154,7 +277,73 @@ struct CompareSummary
 
 	int				aDiffView;
 	diff_results	diffSections;
+
+	ViewMarks		marks[2];	// Per view - moved to the kept compare state (if any) once shown
+};
+
+
+/**
+ *  \struct
+ *  \brief  Last compare results of a pair kept to make the re-compare on change incremental - the diff blocks before
+ *          and after the doc lines changed since keep their sub-block diffs, marks and alignment
+ */
+struct CompareState
+{
+	inline void clear()
+	{
+		for (auto& v : views)
+		{
+			v.comparedHashes.clear();
+			v.comparedFingerprint = 0;
+			v.nonUniqueLines.clear();
+			v.movedRanges.clear();
+			v.marks.clear();
+		}
+
+		lineDiffs.clear();
+		changedCounts.clear();
+		alignmentInfo.clear();
+
+		marksReused	= false;
+		valid		= false;
+	}
+
+	struct ViewState
+	{
+		std::vector<uint64_t>				comparedHashes;	// Compared lines' hashes (lineDiffs refer to those)
+		uint64_t							comparedFingerprint {0};	// Combined comparedHashes
+		std::vector<bool>					nonUniqueLines;
+		std::vector<std::vector<range_t>>	movedRanges;	// Per block diff (block relative compared lines)
+		ViewMarks							marks;
+
+		intptr_t	linesCount {0};
+		intptr_t	docLen {0};
+		unsigned	hashesUse {0};		// Kept doc line hashes use stamp - the doc was not compared elsewhere if same
+
+		range_t		updatedLines;		// Doc lines whose marks the last compare changed (if marksReused)
+	};
+
+	ViewState				views[2];		// Per view
+
+	diff_results			lineDiffs;		// Line diffs (compared line indexes)
+	std::vector<intptr_t>	changedCounts;	// Changed lines pairs per block diff
+	AlignmentInfo_t			alignmentInfo;
+
+	bool					marksReused {false};	// Only updatedLines need rendering, the rest is on screen
+	bool					valid {false};
 };
 
 
-CompareResult compareViews(const CompareOptions& options, const wchar_t* progressInfo, CompareSummary& summary);
+// Line hashes are kept per document between compares (of any pair and mode) so only the lines changed since the
+// last compare of the document are re-hashed. Call on each Scintilla text insertion / deletion to keep them in sync.
+void onDocTextChanged(intptr_t sciDoc, intptr_t line, intptr_t linesAdded, intptr_t lenAdded);
+
+// Drops the kept line hashes of the buffer (on close or if its text was changed without Scintilla notifications)
+void dropDocLineHashes(LRESULT buffId);
+
+// Stops the compare worker threads - call on shutdown, compares are done in the calling thread only after that
+void stopCompareWorkers();
+
+
+CompareResult compareViews(const CompareOptions& options, const wchar_t* progressInfo, CompareSummary& summary,
+	CompareState* state = nullptr);
@@ -0,0 +1,262 @@
+/* Bit-parallel LCS diff algorithm (Allison-Dix / Hyyro) implemented as a C++ template class BitLcsDiff
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include "diff_types.h"
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <bit>
+
+
+/**
+ *  \class  BitLcsDiff
+ *  \brief  Finds the longest common subsequence (LCS) of two sequences processing 64 elements of the first one
+ *			per machine word operation - O(N * M / 64) no matter how different the sequences are. That suits short
+ *			sequences with many differences (line chars) where Myers' O((N + M) * D) degrades.
+ *			The edit script needs the bit-vectors of all steps for the traceback so run() is for sequences approved
+ *			by canRun() only. length() gives just the LCS length and has no size limitation.
+ */
+template <typename Elem>
+class BitLcsDiff : public diff_algorithm<Elem>
+{
+public:
+	BitLcsDiff(ThrowIfCancelledFn cancelCheck = nullptr, DiffWorkspace* workspace = nullptr) :
+		diff_algorithm<Elem>(cancelCheck), _workspace(workspace) {};
+
+	virtual void run(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize, diff_results& diffs, intptr_t off);
+
+	// Returns the length of the longest common subsequence of a and b
+	intptr_t length(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize);
+
+	// Checks if the traceback bit-vectors of the sequences (in both orders) fit in the allowed memory
+	static bool canRun(intptr_t asize, intptr_t bsize)
+	{
+		return (_wordsCount(asize) * (bsize + 1) <= _cMaxHistoryWords &&
+				_wordsCount(bsize) * (asize + 1) <= _cMaxHistoryWords);
+	};
+
+private:
+	static constexpr intptr_t	_cMaxHistoryWords {1 << 16}; // 512 KB
+	static constexpr int		_cCancelCheckItrInterval {1000};
+
+	static inline intptr_t _wordsCount(intptr_t size) { return (size + 63) / 64; };
+
+	// Builds per distinct element of 'a' a bit mask of its positions in 'a' ('words' per mask)
+	void _buildMatchMasks(DiffWorkspace& ws, const Elem* a, intptr_t asize, intptr_t words);
+
+	// Returns the positions mask of element 'e' in 'a' or nullptr if 'e' is not in 'a'
+	inline const uint64_t* _matchMask(const DiffWorkspace& ws, const Elem& e, intptr_t words)
+	{
+		const auto* sym = ws.lcsSymbols.find(static_cast<uint64_t>(e.get_hash()));
+
+		return sym ? ws.lcsMasks.data() + sym->second * words : nullptr;
+	};
+
+	// Advances the bit-vector V (zero bits mark the LCS length increments per 'a' element) by one 'b' element
+	static inline void _step(uint64_t* V, const uint64_t* M, intptr_t words)
+	{
+		uint64_t carry = 0;
+
+		for (intptr_t k = 0; k < words; ++k)
+		{
+			const uint64_t v = V[k];
+			const uint64_t u = v & M[k];
+			const uint64_t t = v + u;
+			const uint64_t sum = t + carry;
+
+			carry = (t < v) | (sum < t);
+			V[k] = sum | (v & ~M[k]);
+		}
+	};
+
+	void _checkCancel()
+	{
+		if (!--_cancelCheckCount)
+		{
+			diff_algorithm<Elem>::ThrowIfCancelled();
+			_cancelCheckCount = _cCancelCheckItrInterval;
+		}
+	};
+
+	DiffWorkspace*	_workspace;
+	int				_cancelCheckCount;
+};
+
+
+template <typename Elem>
+void BitLcsDiff<Elem>::_buildMatchMasks(DiffWorkspace& ws, const Elem* a, intptr_t asize, intptr_t words)
+{
+	ws.lcsSymbols.clear();
+	ws.lcsSymbols.reserve(asize);
+	ws.lcsMasks.clear();
+
+	for (intptr_t i = 0; i < asize; ++i)
+	{
+		auto insertPair = ws.lcsSymbols.try_emplace(static_cast<uint64_t>(a[i].get_hash()),
+				static_cast<intptr_t>(ws.lcsSymbols.size()));
+
+		if (insertPair.second)
+			ws.lcsMasks.resize(ws.lcsMasks.size() + words, 0);
+
+		ws.lcsMasks[insertPair.first->second * words + i / 64] |= uint64_t(1) << (i % 64);
+	}
+}
+
+
+template <typename Elem>
+intptr_t BitLcsDiff<Elem>::length(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize)
+{
+	intptr_t commonLen = 0;
+
+	while (asize && bsize && a[0] == b[0])
+	{
+		++a;
+		++b;
+		--asize;
+		--bsize;
+		++commonLen;
+	}
+
+	while (asize && bsize && a[asize - 1] == b[bsize - 1])
+	{
+		--asize;
+		--bsize;
+		++commonLen;
+	}
+
+	if (!asize || !bsize)
+		return commonLen;
+
+	// Less words per step if the shorter sequence is the bit-vector one
+	if (asize > bsize)
+	{
+		std::swap(a, b);
+		std::swap(asize, bsize);
+	}
+
+	DiffWorkspace localWorkspace;
+	DiffWorkspace& ws = _workspace ? *_workspace : localWorkspace;
+
+	const intptr_t words = _wordsCount(asize);
+
+	_buildMatchMasks(ws, a, asize, words);
+
+	std::vector<uint64_t>& V = ws.lcsV;
+
+	V.assign(words, ~uint64_t(0));
+
+	_cancelCheckCount = _cCancelCheckItrInterval;
+
+	for (intptr_t j = 0; j < bsize; ++j)
+	{
+		const uint64_t* M = _matchMask(ws, b[j], words);
+
+		if (M)
+			_step(V.data(), M, words);
+
+		_checkCancel();
+	}
+
+	intptr_t lcsLen = asize;
+
+	for (intptr_t k = 0; k < words; ++k)
+	{
+		const uint64_t mask = (k == words - 1 && asize % 64) ? (uint64_t(1) << (asize % 64)) - 1 : ~uint64_t(0);
+
+		lcsLen -= std::popcount(V[k] & mask);
+	}
+
+	return commonLen + lcsLen;
+}
+
+
+template <typename Elem>
+void BitLcsDiff<Elem>::run(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize,
+	diff_results& diffs, intptr_t off)
+{
+	a += off;
+	b += off;
+
+	DiffWorkspace localWorkspace;
+	DiffWorkspace& ws = _workspace ? *_workspace : localWorkspace;
+
+	const intptr_t words = _wordsCount(asize);
+
+	// Bit-vector after each 'b' element - needed for the traceback
+	std::vector<uint64_t>& history = ws.lcsV;
+
+	if (asize && bsize)
+	{
+		_buildMatchMasks(ws, a, asize, words);
+
+		history.assign(words * (bsize + 1), ~uint64_t(0));
+
+		_cancelCheckCount = _cCancelCheckItrInterval;
+
+		for (intptr_t j = 0; j < bsize; ++j)
+		{
+			uint64_t* V = history.data() + (j + 1) * words;
+			const uint64_t* M = _matchMask(ws, b[j], words);
+
+			std::copy_n(V - words, words, V);
+
+			if (M)
+				_step(V, M, words);
+
+			_checkCancel();
+		}
+	}
+
+	// Zero bit (i - 1) in the bit-vector after b[j - 1] means that a[i - 1] increments the LCS length there
+	auto lcsIncrementsAt =
+		[&](intptr_t i, intptr_t j)
+		{
+			return !((history[j * words + (i - 1) / 64] >> ((i - 1) % 64)) & 1);
+		};
+
+	// Trace the LCS back from the sequences ends - the diffs are found in reverse order
+	const size_t firstNewDiff = diffs.size();
+
+	intptr_t i = asize;
+	intptr_t j = bsize;
+	intptr_t diffEndA = -1;
+	intptr_t diffEndB = -1;
+
+	while (i > 0 || j > 0)
+	{
+		if (i > 0 && j > 0 && a[i - 1] == b[j - 1])
+		{
+			if (diffEndA >= 0)
+			{
+				diffs.add(i + off, diffEndA + off, j + off, diffEndB + off);
+				diffEndA = -1;
+			}
+
+			--i;
+			--j;
+
+			continue;
+		}
+
+		if (diffEndA < 0)
+		{
+			diffEndA = i;
+			diffEndB = j;
+		}
+
+		if (i > 0 && (j == 0 || !lcsIncrementsAt(i, j)))
+			--i;
+		else
+			--j;
+	}
+
+	if (diffEndA >= 0)
+		diffs.add(off, diffEndA + off, off, diffEndB + off);
+
+	std::reverse(diffs.begin() + firstNewDiff, diffs.end());
+}
@@ -6,59 +6,86 @@
 #pragma once
 
 #include <utility>
-#include <memory>
 #include <vector>
 #include <span>
 #include <exception>
+#include <algorithm>
 
 #include "diff_types.h"
 
 #include "histogram_diff.h"
 #include "myers_diff.h"
+#include "bit_lcs_diff.h"
+#include "patience_diff.h"
 
 
 #ifdef MULTITHREAD
 
-#if defined(__MINGW32__) && !defined(_GLIBCXX_HAS_GTHREADS)
-#include "../mingw-std-threads/mingw.thread.h"
-#else
-#include <thread>
-#endif // __MINGW32__ ...
+#include "task_pool.h"
 
 #endif // MULTITHREAD
 
 
-enum class DiffAlg {
-	HISTOGRAM,
-	MYERS,
-	MIXED
-};
-
-
 /**
  *  \class  DiffCalc
  *  \brief  Compares and makes a differences list between two vectors (elements are template).
-			cancelCheck() is a function that shall throw exception on cancel that shall be handled by upper layers
+			cancelCheck() is a function that shall throw exception on cancel that shall be handled by upper layers.
+			If workspace is given its buffers are used (and kept) for the temporary data, see DiffWorkspace.
+			If boundedCost is set Myers diff runs in bounded time - much different sequences might get a bit less
+			optimal diff, see MyersDiff.
+			Big sequences compared by MIXED or PATIENCE algorithm without sync points are split on their common unique
+			elements into fixed size parts. The parts are compared in parallel if MULTITHREAD is defined - the split
+			does not depend on the threads count so the results are the same either way.
+			AUTO algorithm picks MYERS (small input or much repeated elements at bounded cost), MIXED or PATIENCE
+			from the input statistics - selected_alg() tells which one was used.
  */
 template <typename Elem>
 class DiffCalc
 {
 public:
-	DiffCalc(const std::vector<Elem>& v1, const std::vector<Elem>& v2, ThrowIfCancelledFn cancelCheck = nullptr);
-	DiffCalc(const std::span<Elem>& v1, const std::span<Elem>& v2, ThrowIfCancelledFn cancelCheck = nullptr);
+	DiffCalc(const std::vector<Elem>& v1, const std::vector<Elem>& v2, ThrowIfCancelledFn cancelCheck = nullptr,
+			DiffWorkspace* workspace = nullptr, bool boundedCost = false);
+	DiffCalc(const std::span<Elem>& v1, const std::span<Elem>& v2, ThrowIfCancelledFn cancelCheck = nullptr,
+			DiffWorkspace* workspace = nullptr, bool boundedCost = false);
 	DiffCalc(const Elem* v1, intptr_t v1_size, const Elem* v2, intptr_t v2_size,
-			ThrowIfCancelledFn cancelCheck = nullptr);
+			ThrowIfCancelledFn cancelCheck = nullptr, DiffWorkspace* workspace = nullptr, bool boundedCost = false);
 
 	// Runs the actual compare and returns the differences
 	diff_results operator()(DiffAlg alg = DiffAlg::MIXED,
 			bool doDiffsCombine = false, bool doBoundaryShift = false,
 			const std::vector<std::pair<intptr_t, intptr_t>>& syncPoints = {});
 
+	// The algorithm the last compare ran with (what AUTO resolved to) and if it was at bounded cost
+	DiffAlg selected_alg() const { return _selectedAlg; };
+	bool selected_bounded() const { return _boundedCost; };
+
 	DiffCalc(const DiffCalc&) = delete;
 	const DiffCalc& operator=(const DiffCalc&) = delete;
 
 private:
-	diff_results _run_algo(DiffAlg alg, const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize);
+	void _run_algo(DiffAlg alg, const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize, diff_results& diffs);
+
+	// Minimal size of both sequences to be split
+	static constexpr intptr_t _cMinSplitSize {50000};
+	// Size of a part (both sequences elements count) - smaller ones are not worth the threading overhead
+	static constexpr intptr_t _cSplitPartSize {50000};
+
+	// Splits the sequences on their common unique elements and compares the parts (in parallel if possible).
+	// Returns false if the sequences are not suitable for splitting (nothing done then).
+	bool _split_run(DiffAlg alg, diff_results& diffs);
+
+	// The parts of a split compare are not split further
+	bool _splitAllowed {true};
+
+	// Picks the algorithm for AUTO from cheap statistics of the sequences' differing middle part
+	DiffAlg _select_alg();
+
+	// Percentage of the elements common to both blocks (as multisets)
+	intptr_t _similarity(const range_t& a, const range_t& b);
+
+	// Refines MIXED algorithm's rough diff block by Myers - big blocks at bounded cost or not at all if they have
+	// too little in common
+	void _refine_block(const diff_info& d, diff_results& diffs);
 
 	void _combine_diffs(diff_results& diffs);
 	void _shift_boundaries(diff_results& diffs);
@@ -72,6 +99,30 @@ private:
 
 	ThrowIfCancelledFn _cancelCheck;
 
+	DiffWorkspace	_ownWorkspace;
+	DiffWorkspace&	_ws;
+
+	bool _boundedCost;
+
+	// Biggest block (a and b elements count) that MIXED refines by Myers at full cost
+	static constexpr intptr_t _cMaxRefineSize {10000};
+	// Bigger blocks with less common elements (percent) are not refined
+	static constexpr intptr_t _cMinRefineSimilarity {10};
+
+	// AUTO algorithm selection:
+	// Myers for inputs up to that size (a and b elements count) - its worst case is cheap then
+	static constexpr intptr_t _cAutoMaxMyersSize {2000};
+	// PATIENCE if that many elements (percent of the smaller side) are unique in both sides - it has enough anchors
+	static constexpr intptr_t _cAutoMinUniquePercent {25};
+	// Otherwise MIXED if one side is that many times bigger - Myers is slow for the many one-sided changes
+	static constexpr intptr_t _cAutoMaxAsymmetry {4};
+	// MYERS (if bounded cost is set) if that many elements (percent) occur at least _cAutoRepeatedCount times -
+	// histogram finds no anchors in such input
+	static constexpr intptr_t _cAutoMinRepeatedPercent {50};
+	static constexpr intptr_t _cAutoRepeatedCount {8};
+
+	DiffAlg _selectedAlg {DiffAlg::MIXED};
+
 	bool _diffsCombine;
 	bool _boundaryShift;
 };
@@ -79,32 +130,37 @@ private:
 
 template <typename Elem>
 DiffCalc<Elem>::DiffCalc(const std::vector<Elem>& v1, const std::vector<Elem>& v2,
-		ThrowIfCancelledFn cancelCheck) :
-	_a(v1.data()), _a_size(v1.size()), _b(v2.data()), _b_size(v2.size()), _cancelCheck(cancelCheck)
+		ThrowIfCancelledFn cancelCheck, DiffWorkspace* workspace, bool boundedCost) :
+	_a(v1.data()), _a_size(v1.size()), _b(v2.data()), _b_size(v2.size()), _cancelCheck(cancelCheck),
+	_ws(workspace ? *workspace : _ownWorkspace), _boundedCost(boundedCost)
 {
 }
 
 
 template <typename Elem>
 DiffCalc<Elem>::DiffCalc(const std::span<Elem>& s1, const std::span<Elem>& s2,
-		ThrowIfCancelledFn cancelCheck) :
-	_a(s1.data()), _a_size(s1.size()), _b(s2.data()), _b_size(s2.size()), _cancelCheck(cancelCheck)
+		ThrowIfCancelledFn cancelCheck, DiffWorkspace* workspace, bool boundedCost) :
+	_a(s1.data()), _a_size(s1.size()), _b(s2.data()), _b_size(s2.size()), _cancelCheck(cancelCheck),
+	_ws(workspace ? *workspace : _ownWorkspace), _boundedCost(boundedCost)
 {
 }
 
 
 template <typename Elem>
 DiffCalc<Elem>::DiffCalc(const Elem* v1, intptr_t v1_size, const Elem* v2, intptr_t v2_size,
-		ThrowIfCancelledFn cancelCheck) :
-	_a(v1), _a_size(v1_size), _b(v2), _b_size(v2_size), _cancelCheck(cancelCheck)
+		ThrowIfCancelledFn cancelCheck, DiffWorkspace* workspace, bool boundedCost) :
+	_a(v1), _a_size(v1_size), _b(v2), _b_size(v2_size), _cancelCheck(cancelCheck),
+	_ws(workspace ? *workspace : _ownWorkspace), _boundedCost(boundedCost)
 {
 }
 
 
+// Fills the differences in 'diffs' (cleared first)
 template <typename Elem>
-diff_results DiffCalc<Elem>::_run_algo(DiffAlg alg, const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize)
+void DiffCalc<Elem>::_run_algo(DiffAlg alg, const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize,
+	diff_results& diffs)
 {
-	diff_results diffs;
+	diffs.clear();
 
 	intptr_t off_s = 0;
 
@@ -114,7 +170,7 @@ diff_results DiffCalc<Elem>::_run_algo(DiffAlg alg, const Elem* a, intptr_t asiz
 		++off_s;
 
 	if (asize == bsize && off_s == asize)
-		return diffs;
+		return;
 
 	const intptr_t aend = asize - 1;
 	const intptr_t bend = bsize - 1;
@@ -134,58 +190,60 @@ diff_results DiffCalc<Elem>::_run_algo(DiffAlg alg, const Elem* a, intptr_t asiz
 		bsize -= off_e;
 	}
 
+	if (alg == DiffAlg::BIT_LCS && !BitLcsDiff<Elem>::canRun(asize, bsize))
+		alg = DiffAlg::MYERS;
+
 	const intptr_t histogram_lowcnt = (alg == DiffAlg::MIXED) ? 1 : 250;
 
-	std::unique_ptr<diff_algorithm<Elem>> diff_alg;
+	// The algorithm objects are cheap to create - their temporary buffers are in the workspace
+	MyersDiff<Elem>		myers(_cancelCheck, &_ws, _boundedCost);
+	HistogramDiff<Elem>	histogram(_cancelCheck, histogram_lowcnt, &_ws);
+	BitLcsDiff<Elem>	bitLcs(_cancelCheck, &_ws);
+	PatienceDiff<Elem>	patience(_cancelCheck, &_ws, _boundedCost);
 
-	if (alg == DiffAlg::MYERS)
-		diff_alg.reset(new MyersDiff<Elem>(_cancelCheck));
-	else
-		diff_alg.reset(new HistogramDiff<Elem>(_cancelCheck, histogram_lowcnt));
+	diff_algorithm<Elem>* diff_alg = (alg == DiffAlg::MYERS) ? static_cast<diff_algorithm<Elem>*>(&myers) :
+			(alg == DiffAlg::BIT_LCS) ? static_cast<diff_algorithm<Elem>*>(&bitLcs) :
+			(alg == DiffAlg::PATIENCE) ? static_cast<diff_algorithm<Elem>*>(&patience) :
+			static_cast<diff_algorithm<Elem>*>(&histogram);
 
 	// Compare with swapped sequences as well to see if result is more optimal
 	if (diff_alg->needSwapCheck())
 	{
-		diff_results swapped_diffs;
+		diff_results& swapped_diffs = _ws.swappedDiffs;
+
+		swapped_diffs.clear();
 
 #ifdef MULTITHREAD
-		const bool parallel_run = (asize > 10000 && bsize > 10000 && std::thread::hardware_concurrency() > 1);
+		const bool parallel_run = (asize > 10000 && bsize > 10000 && TaskPool::Get().threadsCount() > 1);
 
 		if (parallel_run)
 		{
-			std::thread thr = std::thread([&]()
-			{
-				try
+			TaskPool::Get().run(2,
+				[&](size_t taskIdx, unsigned)
 				{
-					if (alg == DiffAlg::MYERS)
-						MyersDiff<Elem>(_cancelCheck).run(b, bsize, a, asize, swapped_diffs, off_s);
+					if (taskIdx == 0)
+						diff_alg->run(a, asize, b, bsize, diffs, off_s);
+					// The swapped run uses its own buffers - the workspace is used by the other run in parallel
+					else if (alg == DiffAlg::MYERS)
+						MyersDiff<Elem>(_cancelCheck, nullptr, _boundedCost).run(
+								b, bsize, a, asize, swapped_diffs, off_s);
+					else if (alg == DiffAlg::BIT_LCS)
+						BitLcsDiff<Elem>(_cancelCheck).run(b, bsize, a, asize, swapped_diffs, off_s);
+					else if (alg == DiffAlg::PATIENCE)
+						PatienceDiff<Elem>(_cancelCheck, nullptr, _boundedCost).run(
+								b, bsize, a, asize, swapped_diffs, off_s);
 					else
 						HistogramDiff<Elem>(_cancelCheck, histogram_lowcnt).run(
 								b, bsize, a, asize, swapped_diffs, off_s);
-				}
-				catch (const std::exception&)
-				{
-				}
-			});
-
-			try
-			{
-				diff_alg->run(a, asize, b, bsize, diffs, off_s);
-			}
-			catch (const std::exception&)
-			{
-				std::exception_ptr ep = std::current_exception();
-				thr.join();
-				std::rethrow_exception(ep);
-			}
-
-			thr.join();
+				});
 		}
 		else
 #endif // MULTITHREAD
 		{
 			diff_alg->run(a, asize, b, bsize, diffs, off_s);
-			diff_alg->run(b, bsize, a, asize, swapped_diffs, off_s);
+
+			if (diff_alg->needFullSwapCheck() || diffs.count_replaces() < diffs.count_max_replaces())
+				diff_alg->run(b, bsize, a, asize, swapped_diffs, off_s);
 		}
 
 		const intptr_t swapped_replaces = swapped_diffs.count_replaces();
@@ -193,7 +251,7 @@ diff_results DiffCalc<Elem>::_run_algo(DiffAlg alg, const Elem* a, intptr_t asiz
 		// Check which result is more optimal
 		if (swapped_replaces && swapped_replaces > diffs.count_replaces())
 		{
-			diffs = std::move(swapped_diffs);
+			diffs.swap(swapped_diffs);
 			diffs.swap_ab();
 		}
 	}
@@ -204,8 +262,6 @@ diff_results DiffCalc<Elem>::_run_algo(DiffAlg alg, const Elem* a, intptr_t asiz
 
 	_diffsCombine = _diffsCombine && diff_alg->needDiffsCombine();
 	_boundaryShift = _boundaryShift && diff_alg->needBoundaryShift();
-
-	return diffs;
 }
 
 
@@ -216,11 +272,22 @@ diff_results DiffCalc<Elem>::operator()(DiffAlg alg, bool doDiffsCombine, bool d
 	_diffsCombine = doDiffsCombine;
 	_boundaryShift = doBoundaryShift;
 
+	if (alg == DiffAlg::AUTO)
+		alg = _select_alg();
+
+	_selectedAlg = alg;
+
 	diff_results diffs;
 
+	// Split compare parts are fully compared (MIXED refined as well) - just the post-processing is left then
+	bool splitRun = false;
+
 	if (syncPoints.empty())
 	{
-		diffs = _run_algo(alg, _a, _a_size, _b, _b_size);
+		splitRun = _split_run(alg, diffs);
+
+		if (!splitRun)
+			_run_algo(alg, _a, _a_size, _b, _b_size, diffs);
 	}
 	else
 	{
@@ -233,26 +300,31 @@ diff_results DiffCalc<Elem>::operator()(DiffAlg alg, bool doDiffsCombine, bool d
 				syncP.second < bpos || syncP.second >= _b_size)
 				break;
 
-			diffs.append(_run_algo(alg, &_a[apos], syncP.first - apos, &_b[bpos], syncP.second - bpos), apos, bpos);
+			_run_algo(alg, &_a[apos], syncP.first - apos, &_b[bpos], syncP.second - bpos, _ws.subDiffs);
+			diffs.append(std::move(_ws.subDiffs), apos, bpos);
 
 			apos = syncP.first;
 			bpos = syncP.second;
 		}
 
-		diffs.append(_run_algo(alg, &_a[apos], _a_size - apos, &_b[bpos], _b_size - bpos), apos, bpos);
+		_run_algo(alg, &_a[apos], _a_size - apos, &_b[bpos], _b_size - bpos, _ws.subDiffs);
+		diffs.append(std::move(_ws.subDiffs), apos, bpos);
 	}
 
-	if (alg == DiffAlg::MIXED)
+	if (alg == DiffAlg::MIXED && !splitRun)
 	{
 		_diffsCombine = doDiffsCombine;
 		_boundaryShift = doBoundaryShift;
 
-		diff_results rough_diffs(std::move(diffs));
+		diff_results& rough_diffs = _ws.roughDiffs;
+
+		rough_diffs.swap(diffs);
+		diffs.clear();
 
 		for (const auto& d : rough_diffs)
 		{
 			if (d.a.len() > 1 && d.b.len() > 1)
-				diffs.append(_run_algo(DiffAlg::MYERS, &_a[d.a.s], d.a.len(), &_b[d.b.s], d.b.len()), d.a.s, d.b.s);
+				_refine_block(d, diffs);
 			else
 				diffs.emplace_back(d);
 		}
@@ -268,6 +340,204 @@ diff_results DiffCalc<Elem>::operator()(DiffAlg alg, bool doDiffsCombine, bool d
 }
 
 
+template <typename Elem>
+bool DiffCalc<Elem>::_split_run(DiffAlg alg, diff_results& diffs)
+{
+	if (!_splitAllowed || (alg != DiffAlg::MIXED && alg != DiffAlg::PATIENCE) ||
+		_a_size < _cMinSplitSize || _b_size < _cMinSplitSize)
+		return false;
+
+	// The unique common elements surely match - the parts in between can be compared independently
+	std::vector<std::pair<intptr_t, intptr_t>> anchors;
+
+	PatienceDiff<Elem>(_cancelCheck, &_ws).unique_anchors(_a, _a_size, _b, _b_size, anchors);
+
+	// Fixed size parts (many per thread on big sequences to balance the load) - the split and so the diffs do not
+	// depend on the threads count
+	std::vector<std::pair<intptr_t, intptr_t>> splits;
+
+	splits.emplace_back(0, 0);
+
+	for (const auto& anchor : anchors)
+	{
+		if ((anchor.first - splits.back().first) + (anchor.second - splits.back().second) >= _cSplitPartSize &&
+			(_a_size - anchor.first) + (_b_size - anchor.second) >= _cSplitPartSize)
+			splits.emplace_back(anchor);
+	}
+
+	if (splits.size() < 2)
+		return false;
+
+	splits.emplace_back(_a_size, _b_size);
+
+	const size_t partsCount = splits.size() - 1;
+
+	std::vector<diff_results> partDiffs(partsCount);
+
+	auto comparePart =
+		[&](size_t i, DiffWorkspace* ws)
+		{
+			const auto& s = splits[i];
+			const auto& e = splits[i + 1];
+
+			DiffCalc<Elem> partCalc(_a + s.first, e.first - s.first, _b + s.second, e.second - s.second,
+					_cancelCheck, ws, _boundedCost);
+
+			partCalc._splitAllowed = false;
+
+			partDiffs[i] = partCalc(alg);
+		};
+
+#ifdef MULTITHREAD
+	TaskPool& pool = TaskPool::Get();
+
+	if (pool.threadsCount() > 1)
+	{
+		// The calling thread uses this compare's workspace
+		std::vector<DiffWorkspace> workspaces(pool.threadsCount() - 1);
+
+		// Each pool thread takes the next free part when done with the previous one
+		pool.run(partsCount,
+			[&](size_t i, unsigned slot)
+			{
+				comparePart(i, (slot == 0) ? &_ws : &workspaces[slot - 1]);
+			},
+			_cancelCheck);
+	}
+	else
+#endif // MULTITHREAD
+	{
+		for (size_t i = 0; i < partsCount; ++i)
+			comparePart(i, &_ws);
+	}
+
+	diffs.clear();
+
+	for (size_t i = 0; i < partsCount; ++i)
+		diffs.append(std::move(partDiffs[i]), splits[i].first, splits[i].second);
+
+	return true;
+}
+
+
+template <typename Elem>
+DiffAlg DiffCalc<Elem>::_select_alg()
+{
+	intptr_t off_s = 0;
+
+	while (off_s < _a_size && off_s < _b_size && _a[off_s] == _b[off_s])
+		++off_s;
+
+	intptr_t off_e = 0;
+
+	while (off_e < _a_size - off_s && off_e < _b_size - off_s &&
+			_a[_a_size - 1 - off_e] == _b[_b_size - 1 - off_e])
+		++off_e;
+
+	const Elem* a = _a + off_s;
+	const Elem* b = _b + off_s;
+	const intptr_t asize = _a_size - off_s - off_e;
+	const intptr_t bsize = _b_size - off_s - off_e;
+
+	const intptr_t minSize = std::min(asize, bsize);
+	const intptr_t maxSize = std::max(asize, bsize);
+
+	if (minSize == 0 || asize + bsize <= _cAutoMaxMyersSize)
+		return DiffAlg::MYERS;
+
+	// Occurrences count of each element in a and b
+	FlatHashMap<uint64_t, std::pair<intptr_t, intptr_t>>& counts = _ws.autoCounts;
+
+	counts.clear();
+	counts.reserve(asize);
+
+	for (intptr_t i = 0; i < asize; ++i)
+		++counts[static_cast<uint64_t>(a[i].get_hash())].first;
+
+	for (intptr_t i = 0; i < bsize; ++i)
+		++counts[static_cast<uint64_t>(b[i].get_hash())].second;
+
+	ThrowIfCancelled();
+
+	intptr_t unique = 0;
+	intptr_t repeated = 0;
+
+	for (const auto& c : counts)
+	{
+		if (c.second.first == 1 && c.second.second == 1)
+			++unique;
+
+		if (c.second.first + c.second.second >= _cAutoRepeatedCount)
+			repeated += c.second.first + c.second.second;
+	}
+
+	if (unique * 100 >= minSize * _cAutoMinUniquePercent)
+		return DiffAlg::PATIENCE;
+
+	if (maxSize > minSize * _cAutoMaxAsymmetry)
+		return DiffAlg::MIXED;
+
+	// Bounded cost is the user's choice (it might give less optimal diffs) - never switched on here
+	if (_boundedCost && repeated * 100 >= (asize + bsize) * _cAutoMinRepeatedPercent)
+		return DiffAlg::MYERS;
+
+	return DiffAlg::MIXED;
+}
+
+
+template <typename Elem>
+intptr_t DiffCalc<Elem>::_similarity(const range_t& a, const range_t& b)
+{
+	FlatHashMap<uint64_t, intptr_t>& counts = _ws.refineCounts;
+
+	counts.clear();
+	counts.reserve(a.len());
+
+	for (intptr_t i = a.s; i < a.e; ++i)
+		++counts[static_cast<uint64_t>(_a[i].get_hash())];
+
+	intptr_t common = 0;
+
+	for (intptr_t i = b.s; i < b.e; ++i)
+	{
+		auto* e = counts.find(static_cast<uint64_t>(_b[i].get_hash()));
+
+		if (e && e->second)
+		{
+			--e->second;
+			++common;
+		}
+	}
+
+	return common * 200 / (a.len() + b.len());
+}
+
+
+template <typename Elem>
+void DiffCalc<Elem>::_refine_block(const diff_info& d, diff_results& diffs)
+{
+	const bool bigBlock = (d.a.len() + d.b.len() > _cMaxRefineSize);
+
+	// Rewritten section - Myers would only spend its worst-case time to find scattered coincidental matches
+	if (bigBlock && _similarity(d.a, d.b) < _cMinRefineSimilarity)
+	{
+		diffs.emplace_back(d);
+
+		return;
+	}
+
+	// Big blocks are refined at bounded cost to keep the time near-linear
+	const bool boundedCost = _boundedCost;
+
+	_boundedCost = boundedCost || bigBlock;
+
+	_run_algo(DiffAlg::MYERS, &_a[d.a.s], d.a.len(), &_b[d.b.s], d.b.len(), _ws.subDiffs);
+	diffs.append(std::move(_ws.subDiffs), d.a.s, d.b.s);
+
+	_boundedCost = boundedCost;
+}
+
+
 // If a whole matching block is contained at the end of the next diff block move match down:
 // If [] surrounds the marked differences, basically [abc]d[efgd]hi is the same as [abcdefg]dhi
 // If a whole diff block is contained at the end of the previous match block move diff up:
@@ -316,10 +586,11 @@ void DiffCalc<Elem>::_combine_diffs(diff_results& diffs)
 		{
 			prev_d->e = diff_idx + 1;
 
-			// Diff merged into previous - erase it and recheck previous diff again
+			// Diff merged into previous - erase it and recheck previous diff again (the first diff has nothing to
+			// recheck against)
 			diffs.erase(diffs.begin() + i);
 			--diffs_size;
-			i -= 2;
+			i = (i > 1) ? i - 2 : 0;
 		}
 		// The whole diff block is contained at the end of the previous match -> move diff up and recheck it
 		else if (diff_idx < d->s)
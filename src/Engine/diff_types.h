@@ -10,6 +10,8 @@
 #include <string>
 #include <functional>
 
+#include "flat_hash_map.h"
+
 
 template <typename T>
 struct hash_type
@@ -29,6 +31,21 @@ struct hash_type
 };
 
 
+// Element whose hash is a dense ID (0 to N - 1 where N is about the compared elements count) - interned hash.
+// The diff algorithms can then index arrays by it instead of looking it up in hash maps.
+template <typename T>
+struct dense_id_type : public hash_type<T>
+{
+	using hash_type<T>::hash_type;
+
+	static constexpr bool is_dense_id = true;
+};
+
+
+template <typename Elem>
+concept DenseIdElem = requires { requires Elem::is_dense_id; };
+
+
 // Elements range [s, e) - s included, e excluded
 // Very rudimentary structure used for ease, clarity and speed - not meant for generic usage as it relies on external
 // precautions for data integrity
@@ -123,6 +140,21 @@ struct diff_results : public std::vector<diff_info>
 		return replaces;
 	};
 
+	// The most replaces the changed elements allow - all the changed elements of the less changed side replaced
+	intptr_t count_max_replaces() const noexcept
+	{
+		intptr_t alen = 0;
+		intptr_t blen = 0;
+
+		for (const auto& d : *this)
+		{
+			alen += d.a.len();
+			blen += d.b.len();
+		}
+
+		return (alen < blen ? alen : blen);
+	};
+
 	void add(intptr_t as, intptr_t ae, intptr_t bs, intptr_t be)
 	{
 		this->emplace_back(as, ae, bs, be);
@@ -232,6 +264,84 @@ struct diff_results : public std::vector<diff_info>
 };
 
 
+enum class DiffAlg {
+	HISTOGRAM,
+	MYERS,
+	MIXED,
+	BIT_LCS,	// Myers' results but faster on short, much different sequences (line chars) - MYERS if long
+	PATIENCE,	// Anchors on the unique common elements first - follows the structure of code changes better
+	AUTO		// One of the above picked by the input statistics, see DiffCalc
+};
+
+
+inline const char* diff_alg_name(DiffAlg alg)
+{
+	switch (alg)
+	{
+		case DiffAlg::HISTOGRAM:	return "HISTOGRAM";
+		case DiffAlg::MYERS:		return "MYERS";
+		case DiffAlg::MIXED:		return "MIXED";
+		case DiffAlg::BIT_LCS:		return "BIT_LCS";
+		case DiffAlg::PATIENCE:		return "PATIENCE";
+		case DiffAlg::AUTO:			return "AUTO";
+	}
+
+	return "";
+}
+
+
+// PatienceDiff element occurrences info
+struct PatienceElem
+{
+	intptr_t acount;
+	intptr_t bcount;
+	intptr_t apos;
+	intptr_t bpos;
+};
+
+
+/**
+ *  \struct  DiffWorkspace
+ *  \brief  Scratch buffers used by DiffCalc and the diff algorithms. If the same workspace is given to consecutive
+			DiffCalc runs, the buffers memory is reused between them instead of being allocated anew each time -
+			for the thousands of small compares (words, chars) this removes almost all heap allocations.
+			A workspace must not be shared between threads.
+ */
+struct DiffWorkspace
+{
+	// MyersDiff
+	std::vector<intptr_t>			myersBuf;
+
+	// HistogramDiff
+	FlatHashMap<uint64_t, intptr_t>	amap;
+	std::vector<intptr_t>			alast;
+	std::vector<intptr_t>			anext;
+	std::vector<intptr_t>			bref;
+	std::vector<intptr_t>			acnt;
+	std::vector<intptr_t>			rstack;
+
+	// BitLcsDiff
+	FlatHashMap<uint64_t, intptr_t>	lcsSymbols;
+	std::vector<uint64_t>			lcsMasks;
+	std::vector<uint64_t>			lcsV;
+
+	// PatienceDiff
+	FlatHashMap<uint64_t, PatienceElem>			patienceElems;
+	std::vector<std::pair<intptr_t, intptr_t>>	patienceMatches;
+	std::vector<std::pair<intptr_t, intptr_t>>	patienceAnchors;
+	std::vector<intptr_t>						patienceTails;
+	std::vector<intptr_t>						patiencePrev;
+	diff_results								patienceGapDiffs;
+
+	// DiffCalc
+	FlatHashMap<uint64_t, intptr_t>							refineCounts;
+	FlatHashMap<uint64_t, std::pair<intptr_t, intptr_t>>	autoCounts;
+	diff_results											subDiffs;
+	diff_results											swappedDiffs;
+	diff_results											roughDiffs;
+};
+
+
 using ThrowIfCancelledFn = std::function<void()>;
 
 
@@ -263,6 +373,10 @@ public:
 	virtual bool needDiffsCombine() { return true; };
 	virtual bool needBoundaryShift() { return true; };
 
+	// The swapped sequences run is skipped if the diffs already have all the replaces their changed elements allow.
+	// The swapped run cannot beat that if it changes the same elements count - true for (near) minimal diffs only.
+	virtual bool needFullSwapCheck() { return false; };
+
 protected:
 	void ThrowIfCancelled() { if (_cancelCheck) _cancelCheck(); };
 
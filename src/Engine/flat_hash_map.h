@@ -0,0 +1,200 @@
+/* Flat open-addressing hash map for integral (hash) keys
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <bit>
+
+
+/**
+ *  \class  FlatHashMap
+ *  \brief  Open-addressing (linear probing) hash map keeping all entries in one flat array - no per entry allocations
+ *			and lookups touch adjacent memory only. Meant for integral keys that are usually well mixed hashes already
+ *			so they are just spread over the table by a multiplication (Fibonacci hashing).
+ *			clear() is O(1) and keeps the memory so the map is cheap to reuse. Entries cannot be erased.
+ *			Values of cleared entries are not destroyed until overwritten or the map is rehashed/destroyed.
+ *			Iteration order is unspecified.
+ */
+template <typename Key, typename Value>
+class FlatHashMap
+{
+	static_assert(std::is_integral_v<Key>, "FlatHashMap key must be of integral type");
+
+public:
+	using value_type = std::pair<Key, Value>;
+
+	template <typename MapT, typename EntryT>
+	class iterator_base
+	{
+	public:
+		iterator_base(MapT* map, size_t idx) : _map(map), _idx(idx) { _skipFree(); };
+
+		EntryT& operator*() const { return _map->_slots[_idx]; };
+		EntryT* operator->() const { return &_map->_slots[_idx]; };
+
+		iterator_base& operator++()
+		{
+			++_idx;
+			_skipFree();
+
+			return *this;
+		};
+
+		bool operator==(const iterator_base& rhs) const { return (_idx == rhs._idx); };
+		bool operator!=(const iterator_base& rhs) const { return (_idx != rhs._idx); };
+
+	private:
+		void _skipFree()
+		{
+			while (_idx < _map->_slots.size() && _map->_gens[_idx] != _map->_gen)
+				++_idx;
+		};
+
+		MapT*	_map;
+		size_t	_idx;
+	};
+
+	using iterator = iterator_base<FlatHashMap, value_type>;
+	using const_iterator = iterator_base<const FlatHashMap, const value_type>;
+
+	FlatHashMap() = default;
+	explicit FlatHashMap(size_t count) { reserve(count); };
+
+	// Makes room for 'count' entries so no rehash happens until they are inserted
+	void reserve(size_t count)
+	{
+		size_t capacity = cMinCapacity;
+
+		while (capacity * cMaxLoadNum < count * cMaxLoadDen)
+			capacity *= 2;
+
+		if (capacity > _slots.size())
+			_rehash(capacity);
+	};
+
+	void clear()
+	{
+		_size = 0;
+
+		// The entries are marked free by changing the current generation - they need actual wipe only on wrap around
+		if (++_gen == 0)
+		{
+			std::fill(_gens.begin(), _gens.end(), 0);
+			_gen = 1;
+		}
+	};
+
+	size_t size() const { return _size; };
+	bool empty() const { return (_size == 0); };
+
+	// Returns the entry of 'key' or nullptr if not found
+	value_type* find(Key key)
+	{
+		return const_cast<value_type*>(static_cast<const FlatHashMap*>(this)->find(key));
+	};
+
+	const value_type* find(Key key) const
+	{
+		if (_size == 0)
+			return nullptr;
+
+		for (size_t i = _slotIdx(key); _gens[i] == _gen; i = (i + 1) & _mask)
+		{
+			if (_slots[i].first == key)
+				return &_slots[i];
+		}
+
+		return nullptr;
+	};
+
+	// Inserts 'key' with value constructed from 'args' if 'key' is not present.
+	// Returns the entry of 'key' and true if it was inserted.
+	template <typename... Args>
+	std::pair<value_type*, bool> try_emplace(Key key, Args&&... args)
+	{
+		if ((_size + 1) * cMaxLoadDen > _slots.size() * cMaxLoadNum)
+			_rehash(_slots.empty() ? cMinCapacity : _slots.size() * 2);
+
+		size_t i = _slotIdx(key);
+
+		for (; _gens[i] == _gen; i = (i + 1) & _mask)
+		{
+			if (_slots[i].first == key)
+				return std::make_pair(&_slots[i], false);
+		}
+
+		_gens[i] = _gen;
+		_slots[i].first = key;
+		_slots[i].second = Value(std::forward<Args>(args)...);
+		++_size;
+
+		return std::make_pair(&_slots[i], true);
+	};
+
+	Value& operator[](Key key)
+	{
+		return try_emplace(key).first->second;
+	};
+
+	iterator begin() { return iterator(this, 0); };
+	iterator end() { return iterator(this, _slots.size()); };
+	const_iterator begin() const { return const_iterator(this, 0); };
+	const_iterator end() const { return const_iterator(this, _slots.size()); };
+
+private:
+	static constexpr size_t cMinCapacity {16};
+
+	// Max load factor 3/4
+	static constexpr size_t cMaxLoadNum {3};
+	static constexpr size_t cMaxLoadDen {4};
+
+	inline size_t _slotIdx(Key key) const
+	{
+		return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL) >> _shift);
+	};
+
+	void _rehash(size_t capacity)
+	{
+		std::vector<value_type> oldSlots(capacity);
+		std::vector<uint32_t> oldGens(capacity, 0);
+
+		_slots.swap(oldSlots);
+		_gens.swap(oldGens);
+
+		const uint32_t oldGen = _gen;
+
+		_mask	= capacity - 1;
+		_shift	= 64 - std::countr_zero(static_cast<uint64_t>(capacity));
+		_gen	= 1;
+
+		for (size_t j = 0; j < oldSlots.size(); ++j)
+		{
+			if (oldGens[j] != oldGen)
+				continue;
+
+			size_t i = _slotIdx(oldSlots[j].first);
+
+			while (_gens[i] == _gen)
+				i = (i + 1) & _mask;
+
+			_gens[i] = _gen;
+			_slots[i] = std::move(oldSlots[j]);
+		}
+	};
+
+	std::vector<value_type>	_slots;
+	std::vector<uint32_t>	_gens;	// Entry is used if its generation is the current one
+
+	size_t		_size {0};
+	size_t		_mask {0};
+	int			_shift {64};
+	uint32_t	_gen {1};
+};
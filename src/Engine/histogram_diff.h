@@ -10,19 +10,21 @@
 #include "diff_types.h"
 
 #include <vector>
-#include <unordered_map>
+#include <algorithm>
 
 
 template <typename Elem>
 class HistogramDiff : public diff_algorithm<Elem>
 {
 public:
-	HistogramDiff(ThrowIfCancelledFn cancelCheck = nullptr, intptr_t lowCount = 250) :
-		diff_algorithm<Elem>(cancelCheck), _lowCount(lowCount) {};
+	HistogramDiff(ThrowIfCancelledFn cancelCheck = nullptr, intptr_t lowCount = 250,
+			DiffWorkspace* workspace = nullptr) :
+		diff_algorithm<Elem>(cancelCheck), _lowCount(lowCount), _workspace(workspace) {};
 
 	virtual void run(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize, diff_results& diffs, intptr_t off);
 
 	virtual bool needDiffsCombine() { return false; };
+	virtual bool needFullSwapCheck() { return true; };
 
 private:
 	static constexpr int _cCancelCheckItrInterval {100000};
@@ -75,8 +77,9 @@ private:
 		intptr_t alo, intptr_t ahi, intptr_t blo, intptr_t bhi,
 		intptr_t* malo, intptr_t* mahi, intptr_t* mblo, intptr_t* mbhi);
 
-	intptr_t	_lowCount;
-	int			_cancelCheckCount;
+	intptr_t		_lowCount;
+	int				_cancelCheckCount;
+	DiffWorkspace*	_workspace;
 };
 
 
@@ -89,36 +92,80 @@ void HistogramDiff<Elem>::run(const Elem* a, intptr_t asize, const Elem* b, intp
 	a += off;
 	b += off;
 
-	std::vector<intptr_t> anext(asize + 1, 0);
-	std::vector<intptr_t> bref(bsize + 1, 0);
+	// Use the workspace buffers (if given) to reuse their memory
+	DiffWorkspace localWorkspace;
+	DiffWorkspace& ws = _workspace ? *_workspace : localWorkspace;
+
+	std::vector<intptr_t>& anext	= ws.anext;
+	std::vector<intptr_t>& bref		= ws.bref;
+	std::vector<intptr_t>& acnt		= ws.acnt;
+	std::vector<intptr_t>& rstack	= ws.rstack;
+
+	anext.assign(asize + 1, 0);
+	bref.assign(bsize + 1, 0);
+
+	bool idxHashes = false;
+
+	// Dense IDs are used directly as array index unless they are too sparse in the compared ranges
+	if constexpr (DenseIdElem<Elem>)
 	{
-		std::unordered_map<typename Elem::HashType, intptr_t> amap;
+		size_t idsCount = 0;
 
-		for (intptr_t i = asize; i; i--)
+		for (intptr_t i = 0; i < asize; ++i)
+			idsCount = std::max(idsCount, static_cast<size_t>(a[i].get_hash()) + 1);
+
+		for (intptr_t i = 0; i < bsize; ++i)
+			idsCount = std::max(idsCount, static_cast<size_t>(b[i].get_hash()) + 1);
+
+		idxHashes = (idsCount <= static_cast<size_t>(asize + bsize) * 4 + 1024);
+
+		if (idxHashes)
 		{
-			auto it = amap.find(a[i - 1].get_hash());
+			std::vector<intptr_t>& alast = ws.alast;
 
-			if (it != amap.end())
+			alast.assign(idsCount, 0);
+
+			for (intptr_t i = asize; i; i--)
 			{
-				anext[i] = it->second;
-				it->second = i;
+				intptr_t& last = alast[static_cast<size_t>(a[i - 1].get_hash())];
+
+				anext[i] = last;
+				last = i;
 			}
-			else
+
+			for (intptr_t i = 1; i <= bsize; i++)
+				bref[i] = alast[static_cast<size_t>(b[i - 1].get_hash())];
+		}
+	}
+
+	if (!idxHashes)
+	{
+		FlatHashMap<uint64_t, intptr_t>& amap = ws.amap;
+
+		amap.clear();
+		amap.reserve(asize);
+
+		for (intptr_t i = asize; i; i--)
+		{
+			auto insertPair = amap.try_emplace(static_cast<uint64_t>(a[i - 1].get_hash()), i);
+
+			if (!insertPair.second)
 			{
-				amap[a[i - 1].get_hash()] = i;
+				anext[i] = insertPair.first->second;
+				insertPair.first->second = i;
 			}
 		}
 
 		for (intptr_t i = 1; i <= bsize; i++)
 		{
-			auto it = amap.find(b[i - 1].get_hash());
+			const auto* it = amap.find(static_cast<uint64_t>(b[i - 1].get_hash()));
 
-			if (it != amap.end())
+			if (it)
 				bref[i] = it->second;
 		}
 	}
 
-	std::vector<intptr_t> acnt(asize + 1, 0);
+	acnt.assign(asize + 1, 0);
 
 	for (intptr_t i = 1; i <= asize; i++)
 	{
@@ -132,7 +179,7 @@ void HistogramDiff<Elem>::run(const Elem* a, intptr_t asize, const Elem* b, intp
 	intptr_t alo {0}, ahi {0}, blo {0}, bhi {0}; // bounds of current region
 	intptr_t malo {0}, mahi {0}, mblo {0}, mbhi {0}; // bounds of best matching region
 
-	std::vector<intptr_t> rstack;
+	rstack.clear();
 
 	push_quad(rstack, 1, asize + 1, 1, bsize + 1);
 
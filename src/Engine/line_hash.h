@@ -0,0 +1,286 @@
+/* Streaming 64-bit hash of (whitespace normalized) text - XXH64 compatible
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <bit>
+
+#include "text_scan.h"
+
+
+/**
+ *  \class  LineHasher
+ *  \brief  Hashes text 8 bytes per step (4 independent lanes - 32 bytes per stripe) instead of per character
+ *
+ *  The result equals XXH64 of all the fed bytes. Hashing the text in several parts gives the same result as hashing
+ *  it at once. If nothing is fed digest() returns the seed itself so empty (or fully ignored) text is easily detected.
+ *  Spaces and tabs can be dropped or collapsed on the fly - those are found by SIMD scans (see text_scan.h).
+ */
+class LineHasher
+{
+public:
+	explicit LineHasher(uint64_t seed) : _seed(seed)
+	{
+		_acc[0] = seed + cP1 + cP2;
+		_acc[1] = seed + cP2;
+		_acc[2] = seed;
+		_acc[3] = seed - cP1;
+	}
+
+	template <typename CharT>
+	void update(const CharT* text, size_t len)
+	{
+		_update(reinterpret_cast<const uint8_t*>(text), len * sizeof(CharT));
+	}
+
+	template <typename CharT>
+	void put(CharT c)
+	{
+		_update(reinterpret_cast<const uint8_t*>(&c), sizeof(CharT));
+	}
+
+	// Hashes the text skipping all spaces and tabs
+	template <typename CharT>
+	void updateIgnoreSpaces(const CharT* text, size_t len)
+	{
+		_updateSpaces<CharT, false>(text, len, false);
+	}
+
+	// Hashes the text collapsing each run of spaces and tabs to a single space
+	// If 'trim' is set leading and trailing spaces and tabs are skipped
+	template <typename CharT>
+	void updateCollapseSpaces(const CharT* text, size_t len, bool trim)
+	{
+		_updateSpaces<CharT, true>(text, len, trim);
+	}
+
+	uint64_t digest() const
+	{
+		if (_totalLen == 0)
+			return _seed;
+
+		uint64_t h;
+
+		if (_totalLen >= cStripeLen)
+		{
+			h = std::rotl(_acc[0], 1) + std::rotl(_acc[1], 7) + std::rotl(_acc[2], 12) + std::rotl(_acc[3], 18);
+
+			for (int i = 0; i < 4; ++i)
+				h = _mergeRound(h, _acc[i]);
+		}
+		else
+		{
+			h = _seed + cP5;
+		}
+
+		h += _totalLen;
+
+		const uint8_t* p = _buf;
+		const uint8_t* const end = _buf + _bufLen;
+
+		for (; end - p >= 8; p += 8)
+		{
+			h ^= _round(0, _read64(p));
+			h = std::rotl(h, 27) * cP1 + cP4;
+		}
+
+		if (end - p >= 4)
+		{
+			h ^= static_cast<uint64_t>(_read32(p)) * cP1;
+			h = std::rotl(h, 23) * cP2 + cP3;
+			p += 4;
+		}
+
+		for (; p < end; ++p)
+		{
+			h ^= (*p) * cP5;
+			h = std::rotl(h, 11) * cP1;
+		}
+
+		h ^= h >> 33;
+		h *= cP2;
+		h ^= h >> 29;
+		h *= cP3;
+		h ^= h >> 32;
+
+		return h;
+	}
+
+private:
+	static constexpr uint64_t cP1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t cP2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64_t cP3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64_t cP4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr uint64_t cP5 = 0x27D4EB2F165667C5ULL;
+
+	static constexpr size_t cStripeLen = 32;
+
+	static inline uint64_t _read64(const uint8_t* p)
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static inline uint32_t _read32(const uint8_t* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static inline uint64_t _round(uint64_t acc, uint64_t input)
+	{
+		acc += input * cP2;
+		acc = std::rotl(acc, 31);
+		acc *= cP1;
+
+		return acc;
+	}
+
+	static inline uint64_t _mergeRound(uint64_t h, uint64_t acc)
+	{
+		h ^= _round(0, acc);
+		h = h * cP1 + cP4;
+
+		return h;
+	}
+
+	inline void _stripe(const uint8_t* p)
+	{
+		_acc[0] = _round(_acc[0], _read64(p));
+		_acc[1] = _round(_acc[1], _read64(p + 8));
+		_acc[2] = _round(_acc[2], _read64(p + 16));
+		_acc[3] = _round(_acc[3], _read64(p + 24));
+	}
+
+	void _update(const uint8_t* p, size_t len)
+	{
+		_totalLen += len;
+
+		if (_bufLen + len < cStripeLen)
+		{
+			std::memcpy(_buf + _bufLen, p, len);
+			_bufLen += len;
+
+			return;
+		}
+
+		const uint8_t* const end = p + len;
+
+		if (_bufLen)
+		{
+			const size_t fill = cStripeLen - _bufLen;
+
+			std::memcpy(_buf + _bufLen, p, fill);
+			_stripe(_buf);
+
+			p += fill;
+			_bufLen = 0;
+		}
+
+		for (; static_cast<size_t>(end - p) >= cStripeLen; p += cStripeLen)
+			_stripe(p);
+
+		_bufLen = end - p;
+
+		if (_bufLen)
+			std::memcpy(_buf, p, _bufLen);
+	}
+
+	// Filters the spaces and tabs in a local buffer that is hashed when full - avoids per char branches and hashing
+	template <typename CharT, bool collapse>
+	void _updateSpaces(const CharT* p, size_t len, bool trim)
+	{
+		constexpr size_t cBufLen = 256;
+
+		// Additional room for one whole block as the buffer fullness is checked per block
+		CharT buf[cBufLen + 32];
+		size_t n = 0;
+
+		// Initially set to skip the leading spaces if trimming
+		bool prevSpace = trim;
+
+		auto filter =
+			[&](CharT c, bool isSpace)
+			{
+				if constexpr (collapse)
+				{
+					buf[n] = isSpace ? static_cast<CharT>(' ') : c;
+					n += !(isSpace && prevSpace);
+					prevSpace = isSpace;
+				}
+				else
+				{
+					buf[n] = c;
+					n += !isSpace;
+				}
+			};
+
+		auto flush =
+			[&]()
+			{
+				// Hold back the last (collapsed) space as it might turn out to be trailing
+				const size_t hold = (collapse && trim && prevSpace && n) ? 1 : 0;
+
+				update(buf, n - hold);
+
+				buf[0] = static_cast<CharT>(' ');
+				n = hold;
+			};
+
+		const CharT* const end = p + len;
+
+#ifdef TEXT_SCAN_SSE2
+		if constexpr (cSpacesBlockLen<CharT> > 0)
+		{
+			constexpr size_t blockLen = cSpacesBlockLen<CharT>;
+
+			for (; static_cast<size_t>(end - p) >= blockLen; p += blockLen)
+			{
+				const uint32_t mask = getSpacesMask(p);
+
+				if (mask == 0)
+				{
+					std::memcpy(buf + n, p, blockLen * sizeof(CharT));
+					n += blockLen;
+					prevSpace = false;
+				}
+				else
+				{
+					for (size_t i = 0; i < blockLen; ++i)
+						filter(p[i], (mask >> i) & 1);
+				}
+
+				if (n >= cBufLen)
+					flush();
+			}
+		}
+#endif
+
+		for (; p < end; ++p)
+		{
+			filter(*p, isSpaceOrTab(*p));
+
+			if (n >= cBufLen)
+				flush();
+		}
+
+		// Drop the trailing space
+		if (collapse && trim && prevSpace && n)
+			--n;
+
+		update(buf, n);
+	}
+
+	const uint64_t	_seed;
+	uint64_t		_acc[4];
+	uint64_t		_totalLen {0};
+
+	uint8_t			_buf[cStripeLen];
+	size_t			_bufLen {0};
+};
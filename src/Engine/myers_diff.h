@@ -45,25 +45,35 @@
 #include <cstdint>
 #include <cstdlib>
 #include <climits>
+#include <algorithm>
 
 
+// If boundedCost is set the middle snake search gives up when its cost (edit distance) exceeds a limit derived from
+// the sequences size (the 'too expensive' heuristic of GNU diff) and splits the sequences at the furthest point
+// reached so far instead. The diff is then always valid and found in bounded time but might not be the minimal one.
 template <typename Elem>
 class MyersDiff : public diff_algorithm<Elem>
 {
 public:
-	MyersDiff(ThrowIfCancelledFn cancelCheck = nullptr) : diff_algorithm<Elem>(cancelCheck) {};
+	MyersDiff(ThrowIfCancelledFn cancelCheck = nullptr, DiffWorkspace* workspace = nullptr, bool boundedCost = false) :
+		diff_algorithm<Elem>(cancelCheck), _buf(workspace ? &workspace->myersBuf : nullptr),
+		_boundedCost(boundedCost) {};
 
 	virtual void run(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize, diff_results& diffs, intptr_t off);
 
+	// The bounded cost diff is not minimal so the swapped run might change a different elements count
+	virtual bool needFullSwapCheck() { return _boundedCost; };
+
 private:
 	static constexpr int		_cCancelCheckItrInterval {3000};
-	static constexpr intptr_t	_cDmax {INTPTR_MAX};
+	static constexpr intptr_t	_cMinCostLimit {256};
 
 	template <typename T>
 	struct varray
 	{
 	public:
-		varray() {};
+		// If external buffer is given its memory is reused
+		varray(std::vector<T>* buf = nullptr) : _buf(buf ? *buf : _ownBuf) {};
 		~varray() {};
 
 		// Be very careful when using the returned T reference! It may become invalid on consecutive calls to get()
@@ -82,7 +92,8 @@ private:
 		};
 
 	private:
-		std::vector<T> _buf;
+		std::vector<T>	_ownBuf;
+		std::vector<T>&	_buf;
 	};
 
 	struct middle_snake {
@@ -91,6 +102,7 @@ private:
 
 	inline intptr_t& _v(intptr_t k, intptr_t r);
 	intptr_t _find_middle_snake(intptr_t aoff, intptr_t alen, intptr_t boff, intptr_t blen, middle_snake& ms);
+	void _find_best_split(intptr_t d, intptr_t alen, intptr_t blen, middle_snake& ms);
 	intptr_t _ses(intptr_t aoff, intptr_t alen, intptr_t boff, intptr_t blen);
 
 	int _cancelCheckCount;
@@ -102,6 +114,9 @@ private:
 
 	varray<intptr_t> _buf;
 
+	const bool	_boundedCost;
+	intptr_t	_dmax;
+
 	intptr_t	_as;
 	intptr_t	_ae;
 	intptr_t	_bs;
@@ -116,6 +131,19 @@ void MyersDiff<Elem>::run(const Elem* a, intptr_t asize, const Elem* b, intptr_t
 {
 	_cancelCheckCount = _cCancelCheckItrInterval;
 
+	_dmax = INTPTR_MAX;
+
+	if (_boundedCost)
+	{
+		// About the square root of the sequences total length as in GNU diff
+		_dmax = 1;
+
+		for (intptr_t diags = asize + bsize + 3; diags; diags >>= 2)
+			_dmax <<= 1;
+
+		_dmax = std::max(_dmax, _cMinCostLimit);
+	}
+
 	_a = a;
 	_b = b;
 
@@ -132,7 +160,7 @@ void MyersDiff<Elem>::run(const Elem* a, intptr_t asize, const Elem* b, intptr_t
 	else if (!_last_was_match)
 		diffs.add(_as, _ae, _bs, _be);
 
-	// Wipe temporal buffer to free memory
+	// Wipe temporal buffer (its memory is kept for the next run if it is a workspace buffer)
 	_buf.get().clear();
 }
 
@@ -162,8 +190,11 @@ intptr_t MyersDiff<Elem>::_find_middle_snake(
 	{
 		intptr_t k, x, y;
 
-		if ((2 * d - 1) >= _cDmax)
-			return _cDmax;
+		if (d > _dmax)
+		{
+			_find_best_split(d, alen, blen, ms);
+			return 2 * d;
+		}
 
 		if (!--_cancelCheckCount)
 		{
@@ -245,6 +276,90 @@ intptr_t MyersDiff<Elem>::_find_middle_snake(
 }
 
 
+// Called when the middle snake search is too expensive - makes an empty snake (split point) out of the forward or
+// backward path that got further (the paths of cost d - 1 are at hand)
+template <typename Elem>
+void MyersDiff<Elem>::_find_best_split(intptr_t d, intptr_t alen, intptr_t blen, middle_snake& ms)
+{
+	const intptr_t delta = alen - blen;
+
+	// Forward diagonal that maximizes x + y
+	intptr_t fxybest = -1;
+	intptr_t fxbest = 0;
+
+	for (intptr_t k = d - 1; k >= -(d - 1); k -= 2)
+	{
+		intptr_t x = std::min(_v(k, 0), alen);
+		intptr_t y = x - k;
+
+		if (y > blen)
+		{
+			x = blen + k;
+			y = blen;
+		}
+
+		if (x < 0 || y < 0)
+			continue;
+
+		if (fxybest < x + y)
+		{
+			fxybest = x + y;
+			fxbest = x;
+		}
+	}
+
+	// Backward diagonal that minimizes x + y
+	intptr_t bxybest = INTPTR_MAX;
+	intptr_t bxbest = 0;
+
+	for (intptr_t k = d - 1; k >= -(d - 1); k -= 2)
+	{
+		const intptr_t kr = delta + k;
+
+		intptr_t x = std::max(_v(kr, 1), intptr_t(0));
+		intptr_t y = x - kr;
+
+		if (y < 0)
+		{
+			x = kr;
+			y = 0;
+		}
+
+		if (x > alen || y > blen)
+			continue;
+
+		if (x + y < bxybest)
+		{
+			bxybest = x + y;
+			bxbest = x;
+		}
+	}
+
+	intptr_t x, y;
+
+	if (fxybest >= 0 && (bxybest == INTPTR_MAX || (alen + blen) - bxybest < fxybest))
+	{
+		x = fxbest;
+		y = fxybest - fxbest;
+	}
+	else
+	{
+		x = bxbest;
+		y = bxybest - bxbest;
+	}
+
+	// Split must reduce the problem - fall back to a plain removal of a and insertion of b
+	if ((x == 0 && y == 0) || (x == alen && y == blen))
+	{
+		x = alen;
+		y = 0;
+	}
+
+	ms.x = ms.u = x;
+	ms.y = ms.v = y;
+}
+
+
 template <typename Elem>
 intptr_t MyersDiff<Elem>::_ses(
 	intptr_t aoff, intptr_t alen, intptr_t boff, intptr_t blen)
@@ -294,9 +409,6 @@ intptr_t MyersDiff<Elem>::_ses(
 		if (d == -1)
 			return -1;
 
-		if (d >= _cDmax)
-			return _cDmax;
-
 		if (d > 1)
 		{
 			if (_ses(aoff, ms.x, boff, ms.y) == -1)
@@ -0,0 +1,278 @@
+/* Patience diff algorithm implemented as a C++ template class PatienceDiff
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include "diff_types.h"
+#include "myers_diff.h"
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+
+/**
+ *  \class  PatienceDiff
+ *  \brief  Matches first the elements that are unique in both sequences - the longest common subsequence of those
+ *			(found by patience sorting) splits the sequences and the gaps in between are processed the same way.
+ *			Gaps without common unique elements are compared by Myers diff.
+ *			The often repeated elements (blank lines, braces, 'end' and alike) are never used as anchors so the diff
+ *			follows the meaningful lines and the run time is near linear on typical code.
+ */
+template <typename Elem>
+class PatienceDiff : public diff_algorithm<Elem>
+{
+public:
+	PatienceDiff(ThrowIfCancelledFn cancelCheck = nullptr, DiffWorkspace* workspace = nullptr,
+			bool boundedCost = false) :
+		diff_algorithm<Elem>(cancelCheck), _cancelCheck(cancelCheck), _workspace(workspace),
+		_boundedCost(boundedCost) {};
+
+	virtual void run(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize, diff_results& diffs, intptr_t off);
+
+	// The anchors make the diff non-minimal so the swapped run might change a different elements count
+	virtual bool needFullSwapCheck() { return true; };
+
+	// Fills the longest chain of the elements unique in both a and b (pairs of a and b positions, both increasing) -
+	// a and b surely match there
+	void unique_anchors(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize,
+			std::vector<std::pair<intptr_t, intptr_t>>& anchors);
+
+private:
+	static constexpr int _cCancelCheckItrInterval {1000};
+
+	// Adds the diff merging it with the previous one if they are adjacent
+	static void _add_diff(diff_results& diffs, intptr_t as, intptr_t ae, intptr_t bs, intptr_t be)
+	{
+		if (!diffs.empty() && diffs.back().a.e == as && diffs.back().b.e == bs)
+		{
+			diffs.back().a.e = ae;
+			diffs.back().b.e = be;
+		}
+		else
+		{
+			diffs.add(as, ae, bs, be);
+		}
+	};
+
+	// Fills the matches of the elements unique in both a and b ranges (in a order) - returns their count
+	intptr_t _find_unique_matches(DiffWorkspace& ws, intptr_t alo, intptr_t ahi, intptr_t blo, intptr_t bhi);
+
+	// Leaves in the unique matches only their longest common subsequence (b positions increasing)
+	void _patience_sort(DiffWorkspace& ws);
+
+	ThrowIfCancelledFn	_cancelCheck;
+	DiffWorkspace*		_workspace;
+	const bool			_boundedCost;
+
+	const Elem*	_a;
+	const Elem*	_b;
+};
+
+
+template <typename Elem>
+intptr_t PatienceDiff<Elem>::_find_unique_matches(DiffWorkspace& ws,
+	intptr_t alo, intptr_t ahi, intptr_t blo, intptr_t bhi)
+{
+	auto& elems = ws.patienceElems;
+
+	elems.clear();
+	elems.reserve(ahi - alo);
+
+	for (intptr_t i = alo; i < ahi; ++i)
+	{
+		auto insertPair = elems.try_emplace(static_cast<uint64_t>(_a[i].get_hash()));
+
+		if (insertPair.second)
+			insertPair.first->second = {1, 0, i, 0};
+		else
+			++insertPair.first->second.acount;
+	}
+
+	for (intptr_t i = blo; i < bhi; ++i)
+	{
+		auto* e = elems.find(static_cast<uint64_t>(_b[i].get_hash()));
+
+		if (e && e->second.acount == 1)
+		{
+			++e->second.bcount;
+			e->second.bpos = i;
+		}
+	}
+
+	auto& matches = ws.patienceMatches;
+
+	matches.clear();
+
+	// Traverse a to have the matches ordered by a positions
+	for (intptr_t i = alo; i < ahi; ++i)
+	{
+		const auto* e = elems.find(static_cast<uint64_t>(_a[i].get_hash()));
+
+		if (e->second.acount == 1 && e->second.bcount == 1)
+			matches.emplace_back(i, e->second.bpos);
+	}
+
+	return static_cast<intptr_t>(matches.size());
+}
+
+
+template <typename Elem>
+void PatienceDiff<Elem>::_patience_sort(DiffWorkspace& ws)
+{
+	auto& matches	= ws.patienceMatches;
+	auto& tails		= ws.patienceTails;	// Top match idx of each pile
+	auto& prev		= ws.patiencePrev;	// Top match idx of the previous pile at the time the match was placed
+
+	tails.clear();
+	prev.resize(matches.size());
+
+	for (intptr_t i = 0; i < static_cast<intptr_t>(matches.size()); ++i)
+	{
+		const intptr_t bpos = matches[i].second;
+
+		// Leftmost pile whose top is after bpos in b
+		const auto pile = std::partition_point(tails.begin(), tails.end(),
+				[&](intptr_t t) { return matches[t].second < bpos; });
+
+		prev[i] = (pile == tails.begin()) ? -1 : *(pile - 1);
+
+		if (pile == tails.end())
+			tails.emplace_back(i);
+		else
+			*pile = i;
+	}
+
+	const intptr_t lisLen = static_cast<intptr_t>(tails.size());
+
+	// Backtrack the longest chain from the top of the last pile - its match indexes are collected first as the chain
+	// can pass through matches that would already be overwritten if moved in place right away
+	for (intptr_t k = lisLen - 1, i = lisLen ? tails.back() : -1; k >= 0; --k, i = prev[i])
+		tails[k] = i;
+
+	// Chain indexes are increasing and tails[k] >= k so moving the matches in ascending order is safe
+	for (intptr_t k = 0; k < lisLen; ++k)
+		matches[k] = matches[tails[k]];
+
+	matches.resize(lisLen);
+}
+
+
+template <typename Elem>
+void PatienceDiff<Elem>::unique_anchors(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize,
+	std::vector<std::pair<intptr_t, intptr_t>>& anchors)
+{
+	_a = a;
+	_b = b;
+
+	DiffWorkspace localWorkspace;
+	DiffWorkspace& ws = _workspace ? *_workspace : localWorkspace;
+
+	anchors.clear();
+
+	if (!_find_unique_matches(ws, 0, asize, 0, bsize))
+		return;
+
+	_patience_sort(ws);
+
+	anchors.assign(ws.patienceMatches.begin(), ws.patienceMatches.end());
+}
+
+
+template <typename Elem>
+void PatienceDiff<Elem>::run(const Elem* a, intptr_t asize, const Elem* b, intptr_t bsize,
+	diff_results& diffs, intptr_t off)
+{
+	_a = a;
+	_b = b;
+
+	DiffWorkspace localWorkspace;
+	DiffWorkspace& ws = _workspace ? *_workspace : localWorkspace;
+
+	// Ranges (alo, ahi, blo, bhi) to process - popped in ascending order so the diffs are found ordered
+	std::vector<intptr_t>& rstack = ws.rstack;
+
+	rstack.clear();
+	rstack.insert(rstack.end(), {off, off + asize, off, off + bsize});
+
+	std::vector<std::pair<intptr_t, intptr_t>>& anchors = ws.patienceAnchors;
+	diff_results& gapDiffs = ws.patienceGapDiffs;
+
+	int cancelCheckCount = _cCancelCheckItrInterval;
+
+	while (!rstack.empty())
+	{
+		intptr_t bhi = rstack.back();
+		rstack.pop_back();
+		intptr_t blo = rstack.back();
+		rstack.pop_back();
+		intptr_t ahi = rstack.back();
+		rstack.pop_back();
+		intptr_t alo = rstack.back();
+		rstack.pop_back();
+
+		if (!--cancelCheckCount)
+		{
+			diff_algorithm<Elem>::ThrowIfCancelled();
+			cancelCheckCount = _cCancelCheckItrInterval;
+		}
+
+		while (alo < ahi && blo < bhi && _a[alo] == _b[blo])
+		{
+			++alo;
+			++blo;
+		}
+
+		while (alo < ahi && blo < bhi && _a[ahi - 1] == _b[bhi - 1])
+		{
+			--ahi;
+			--bhi;
+		}
+
+		if (alo == ahi || blo == bhi)
+		{
+			if (alo < ahi || blo < bhi)
+				_add_diff(diffs, alo, ahi, blo, bhi);
+
+			continue;
+		}
+
+		if (!_find_unique_matches(ws, alo, ahi, blo, bhi))
+		{
+			// MyersDiff expects a and b to start with a diff at the same offset - pass the ranges as separate
+			// sequences and shift the result
+			gapDiffs.clear();
+
+			MyersDiff<Elem>(_cancelCheck, &ws, _boundedCost).run(
+					_a + alo, ahi - alo, _b + blo, bhi - blo, gapDiffs, 0);
+
+			for (const auto& d : gapDiffs)
+				_add_diff(diffs, d.a.s + alo, d.a.e + alo, d.b.s + blo, d.b.e + blo);
+
+			continue;
+		}
+
+		_patience_sort(ws);
+
+		// The workspace matches are overwritten by the nested ranges processing - keep the anchors aside
+		anchors.assign(ws.patienceMatches.begin(), ws.patienceMatches.end());
+
+		// Push the gaps between the anchors in reverse order so they are processed in ascending order
+		intptr_t gapAhi = ahi;
+		intptr_t gapBhi = bhi;
+
+		for (auto anchor = anchors.rbegin(); anchor != anchors.rend(); ++anchor)
+		{
+			if (anchor->first + 1 < gapAhi || anchor->second + 1 < gapBhi)
+				rstack.insert(rstack.end(), {anchor->first + 1, gapAhi, anchor->second + 1, gapBhi});
+
+			gapAhi = anchor->first;
+			gapBhi = anchor->second;
+		}
+
+		if (alo < gapAhi || blo < gapBhi)
+			rstack.insert(rstack.end(), {alo, gapAhi, blo, gapBhi});
+	}
+}
@@ -0,0 +1,216 @@
+/* Engine-wide pool of worker threads running parallel compare tasks
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+#if defined(__MINGW32__) && !defined(_GLIBCXX_HAS_GTHREADS)
+#include "../mingw-std-threads/mingw.thread.h"
+#include "../mingw-std-threads/mingw.mutex.h"
+#include "../mingw-std-threads/mingw.condition_variable.h"
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif // __MINGW32__ ...
+
+
+/**
+ *  \class  TaskPool
+ *  \brief  Persistent worker threads (hardware threads count - 1) shared by all parallel parts of the compare -
+ *			no threads are created per compare. The workers are started on first use and live until Stop().
+ *			run() executes a batch of indexed tasks on the idle workers and the calling thread together and returns
+ *			when all are done. Batches can be nested (run() called from a task) - the caller executes its own batch
+ *			tasks so it never waits for a free worker.
+ *			Each task gets a slot index unique among the threads running the batch - 0 is the calling thread,
+ *			workers are 1 to threadsCount() - 1. It is meant to select per-thread data (DiffWorkspace for example).
+ *			If a task throws (or cancelCheck() throws on cancel) the rest of the batch tasks are skipped and
+ *			the exception is rethrown in the calling thread.
+ */
+class TaskPool
+{
+public:
+	using TaskFn = std::function<void(size_t taskIdx, unsigned slot)>;
+
+	static TaskPool& Get()
+	{
+		static TaskPool pool;
+
+		return pool;
+	};
+
+	// Number of threads that can run batch tasks in parallel (workers and the calling thread)
+	unsigned threadsCount() const
+	{
+		return _threadsCount;
+	};
+
+	// Runs fn() for task indexes [0, tasksCount) and waits for them all - cancelCheck() is called before each task
+	void run(size_t tasksCount, const TaskFn& fn, const std::function<void()>& cancelCheck = nullptr)
+	{
+		if (tasksCount == 0)
+			return;
+
+		auto batch = std::make_shared<Batch>(tasksCount, fn, cancelCheck);
+
+		// Nothing to share - the calling thread does it all
+		if (tasksCount > 1 && _threadsCount > 1)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (_workers.empty() && !_stopped)
+				_startWorkers();
+
+			if (!_workers.empty())
+			{
+				_batches.emplace_back(batch);
+				_workersCV.notify_all();
+			}
+		}
+
+		_execute(*batch, 0);
+
+		{
+			std::unique_lock<std::mutex> lock(batch->mutex);
+
+			batch->doneCV.wait(lock, [&]() { return batch->done == batch->count; });
+		}
+
+		if (batch->error)
+			std::rethrow_exception(batch->error);
+	};
+
+	// Stops and joins the workers - batches run after that are executed by the calling thread only
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			_stopped = true;
+			_workersCV.notify_all();
+		}
+
+		for (auto& th : _workers)
+		{
+			if (th.joinable())
+				th.join();
+		}
+
+		_workers.clear();
+	};
+
+	TaskPool(const TaskPool&) = delete;
+	TaskPool& operator=(const TaskPool&) = delete;
+
+private:
+	struct Batch
+	{
+		Batch(size_t tasksCount, const TaskFn& taskFn, const std::function<void()>& cancelCheckFn) :
+			count(tasksCount), fn(taskFn), cancelCheck(cancelCheckFn) {};
+
+		const size_t					count;
+		const TaskFn&					fn;
+		const std::function<void()>&	cancelCheck;
+
+		std::atomic<size_t>	next {0};
+		std::atomic<bool>	failed {false};
+
+		std::mutex				mutex;
+		std::condition_variable	doneCV;
+		size_t					done {0};
+		std::exception_ptr		error;
+	};
+
+	TaskPool() : _threadsCount(std::max(std::thread::hardware_concurrency(), 1u)) {};
+
+	~TaskPool()
+	{
+		Stop();
+	};
+
+	void _startWorkers()
+	{
+		_workers.reserve(_threadsCount - 1);
+
+		for (unsigned i = 1; i < _threadsCount; ++i)
+			_workers.emplace_back(&TaskPool::_workerFn, this, i);
+	};
+
+	void _workerFn(unsigned slot)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		for (;;)
+		{
+			_workersCV.wait(lock, [&]() { return _stopped || !_batches.empty(); });
+
+			if (_stopped)
+				return;
+
+			std::shared_ptr<Batch> batch = _batches.front();
+
+			// All batch tasks are taken - it is up to the threads that took them to finish the batch
+			if (batch->next >= batch->count)
+			{
+				_batches.pop_front();
+				continue;
+			}
+
+			lock.unlock();
+
+			_execute(*batch, slot);
+
+			lock.lock();
+		}
+	};
+
+	// Executes batch tasks as long as there are free ones
+	static void _execute(Batch& batch, unsigned slot)
+	{
+		for (size_t i = batch.next++; i < batch.count; i = batch.next++)
+		{
+			if (!batch.failed)
+			{
+				try
+				{
+					if (batch.cancelCheck)
+						batch.cancelCheck();
+
+					batch.fn(i, slot);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(batch.mutex);
+
+					if (!batch.error)
+						batch.error = std::current_exception();
+
+					batch.failed = true;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(batch.mutex);
+
+			if (++batch.done == batch.count)
+				batch.doneCV.notify_all();
+		}
+	};
+
+	const unsigned _threadsCount;
+
+	std::mutex							_mutex;
+	std::condition_variable				_workersCV;
+	std::vector<std::thread>			_workers;
+	std::deque<std::shared_ptr<Batch>>	_batches;
+	bool								_stopped {false};
+};
@@ -0,0 +1,150 @@
+/* Fast text scanning helpers used on raw document buffers
+ * Copyright (C) 2026  Pavel Nedev <pg.nedev@gmail.com>
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TEXT_SCAN_SSE2	1
+#include <emmintrin.h>
+#endif
+
+// Used only if the compiler is allowed to generate AVX2 code (/arch:AVX2 or -mavx2)
+#if defined(TEXT_SCAN_SSE2) && defined(__AVX2__)
+#define TEXT_SCAN_AVX2	1
+#include <immintrin.h>
+#endif
+
+
+// Returns pointer to the first EOL char ('\r' or '\n') in the range [p, end) or 'end' if there is no such
+inline const char* findEOL(const char* p, const char* end)
+{
+#ifdef TEXT_SCAN_SSE2
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+
+	for (; end - p >= 16; p += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const unsigned mask = static_cast<unsigned>(
+				_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf))));
+
+		if (mask)
+			return p + std::countr_zero(mask);
+	}
+#endif
+
+	for (; p < end; ++p)
+	{
+		if (*p == '\n' || *p == '\r')
+			return p;
+	}
+
+	return end;
+}
+
+
+// Returns pointer past the EOL sequence (CR, LF or CR+LF) starting at 'eol' (as returned by findEOL())
+inline const char* skipEOL(const char* eol, const char* end)
+{
+	if (eol < end && *eol++ == '\r' && eol < end && *eol == '\n')
+		++eol;
+
+	return eol;
+}
+
+
+template <typename CharT>
+inline bool isSpaceOrTab(CharT c)
+{
+	return (c == static_cast<CharT>(' ') || c == static_cast<CharT>('\t'));
+}
+
+
+#ifdef TEXT_SCAN_SSE2
+
+// Chars count in a block processed by getSpacesMask() (0 - not supported for that char type)
+template <typename CharT>
+constexpr size_t cSpacesBlockLen =
+#ifdef TEXT_SCAN_AVX2
+		(sizeof(CharT) == 1) ? 32 :
+#else
+		(sizeof(CharT) == 1) ? 16 :
+#endif
+		(sizeof(CharT) == 2) ? 8 : 0;
+
+
+// Returns bit mask of the spaces and tabs in the block of cSpacesBlockLen chars at 'p' (bit 0 is the first char)
+template <typename CharT>
+inline uint32_t getSpacesMask(const CharT* p)
+{
+	if constexpr (sizeof(CharT) == 1)
+	{
+#ifdef TEXT_SCAN_AVX2
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')))));
+#else
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(
+				_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')))));
+#endif
+	}
+	else
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const __m128i spaces = _mm_or_si128(
+				_mm_cmpeq_epi16(chunk, _mm_set1_epi16(' ')), _mm_cmpeq_epi16(chunk, _mm_set1_epi16('\t')));
+
+		// Pack the 16-bit compare results to bytes to get one mask bit per char
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(spaces, _mm_setzero_si128())));
+	}
+}
+
+#endif // TEXT_SCAN_SSE2
+
+
+// Copies 'len' chars from 'src' to 'dst' lower-casing the ASCII letters. Stops on the first non-ASCII char.
+// Returns the count of chars copied ('len' if all are ASCII).
+inline size_t toLowerASCII(const char* src, size_t len, char* dst)
+{
+	size_t i = 0;
+
+#ifdef TEXT_SCAN_SSE2
+	const __m128i beforeA	= _mm_set1_epi8('A' - 1);
+	const __m128i afterZ	= _mm_set1_epi8('Z' + 1);
+	const __m128i caseBit	= _mm_set1_epi8(0x20);
+
+	for (; len - i >= 16; i += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+		// Non-ASCII chars have the sign bit set
+		if (_mm_movemask_epi8(chunk))
+			break;
+
+		const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, beforeA), _mm_cmpgt_epi8(afterZ, chunk));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(chunk, _mm_and_si128(upper, caseBit)));
+	}
+#endif
+
+	for (; i < len; ++i)
+	{
+		const char c = src[i];
+
+		if (c & 0x80)
+			break;
+
+		dst[i] = (c >= 'A' && c <= 'Z') ? (c | 0x20) : c;
+	}
+
+	return i;
+}
@@ -271,6 +271,11 @@ struct ViewLocation
 		return _view;
 	}
 
+	inline intptr_t getFirstLine() const
+	{
+		return _firstLine;
+	}
+
 private:
 	int			_view {-1};
 	intptr_t	_firstLine {-1};
@@ -474,6 +479,14 @@ inline LRESULT getCurrentBuffId()
 }
 
 
+inline LRESULT getCurrentBuffId(int view)
+{
+	const LRESULT index = CallNpp(NPPM_GETCURRENTDOCINDEX, 0, view);
+
+	return (index < 0) ? 0 : CallNpp(NPPM_GETBUFFERIDFROMPOS, index, view);
+}
+
+
 inline int getEncoding(LRESULT buffId)
 {
 	return static_cast<int>(::SendMessageW(nppData._nppHandle, NPPM_GETBUFFERENCODING, buffId, 0));
@@ -925,6 +938,13 @@ inline void deleteLine(int view, intptr_t line)
 }
 
 
+// Direct read-only access to the document buffer - valid until the document is modified
+inline const char* getRangePointer(int view, intptr_t startPos, intptr_t endPos)
+{
+	return reinterpret_cast<const char*>(CallScintilla(view, SCI_GETRANGEPOINTER, startPos, endPos - startPos));
+}
+
+
 std::vector<char> getText(int view, intptr_t startPos, intptr_t endPos);
 std::vector<char> getLineText(int view, intptr_t line, bool includeEOL = false);
 
@@ -51,7 +51,7 @@ const int ProgressDlg::cPhases[] = {
 progress_ptr ProgressDlg::Inst;
 
 
-progress_ptr& ProgressDlg::Open(const wchar_t* info)
+progress_ptr& ProgressDlg::Open(const wchar_t* info, bool lockNpp)
 {
 	if (Inst)
 		return Inst;
@@ -66,7 +66,10 @@ progress_ptr& ProgressDlg::Open(const wchar_t* info)
 		}
 		else
 		{
-			::EnableWindow(nppData._nppHandle, FALSE);
+			Inst->_nppLocked = lockNpp;
+
+			if (lockNpp)
+				::EnableWindow(nppData._nppHandle, FALSE);
 
 			if (info)
 				Inst->SetInfo(info);
@@ -166,7 +169,7 @@ void ProgressDlg::Advance(intptr_t cnt, unsigned phase)
 }
 
 
-ProgressDlg::ProgressDlg() : _hwnd(NULL), _hFont(NULL), _hKeyHook(NULL),
+ProgressDlg::ProgressDlg() : _hwnd(NULL), _hFont(NULL), _hKeyHook(NULL), _nppLocked(false),
 		_phase(0), _phaseRange(cPhases[0]), _phasePosOffset(0), _max(cPhases[0]), _count(0), _pos(0)
 {
 	::GetModuleHandleExW(
@@ -203,7 +206,9 @@ ProgressDlg::~ProgressDlg()
 
 	destroy();
 
-	::EnableWindow(nppData._nppHandle, TRUE);
+	if (_nppLocked)
+		::EnableWindow(nppData._nppHandle, TRUE);
+
 	::SetForegroundWindow(nppData._nppHandle);
 
 	::UnregisterClassW(cClassName, _hInst);
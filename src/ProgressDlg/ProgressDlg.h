@@ -37,7 +37,8 @@ class ProgressDlg
 public:
 	static const std::string cCancelledCause;
 
-	static progress_ptr& Open(const wchar_t* info = NULL);
+	// If lockNpp is false Notepad++ is left enabled - its input shall be filtered by the caller then
+	static progress_ptr& Open(const wchar_t* info = NULL, bool lockNpp = true);
 
 	static progress_ptr& Get()
 	{
@@ -115,6 +116,8 @@ private:
 	HWND			_hBtn;
 	HHOOK			_hKeyHook;
 
+	bool		_nppLocked;
+
 	unsigned	_phase;
 	unsigned	_phaseRange;
 	unsigned	_phasePosOffset;
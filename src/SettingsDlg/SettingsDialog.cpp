@@ -149,6 +149,7 @@ INT_PTR CALLBACK SettingsDialog::run_dlgProc(UINT Message, WPARAM wParam, LPARAM
 					settings.FollowingCaret			= (bool) DEFAULT_FOLLOWING_CARET;
 					settings.WrapAround				= (bool) DEFAULT_WRAP_AROUND;
 					settings.GotoFirstDiff			= (bool) DEFAULT_GOTO_FIRST_DIFF;
+					settings.FastApproxDiff			= (bool) DEFAULT_FAST_APPROX_DIFF;
 
 					settings.StatusInfo				= static_cast<StatusType>(DEFAULT_STATUS_INFO);
 
@@ -312,6 +313,7 @@ void SettingsDialog::updateLocalization()
 	updateDlgCtrlTxt(_hSelf, IDC_FOLLOWING_CARET,		str["IDC_FOLLOWING_CARET"].c_str(), true);
 	updateDlgCtrlTxt(_hSelf, IDC_WRAP_AROUND,			str["IDC_WRAP_AROUND"].c_str(), true);
 	updateDlgCtrlTxt(_hSelf, IDC_GOTO_FIRST_DIFF,		str["IDC_GOTO_FIRST_DIFF"].c_str(), true);
+	updateDlgCtrlTxt(_hSelf, IDC_FAST_APPROX_DIFF,		str["IDC_FAST_APPROX_DIFF"].c_str(), true);
 	updateDlgCtrlTxt(_hSelf, IDC_ENABLE_TOOLBAR,		str["IDC_ENABLE_TOOLBAR"].c_str(), true);
 	updateDlgCtrlTxt(_hSelf, IDC_SET_AS_FIRST_TB,		str["IDC_SET_AS_FIRST_TB"].c_str(), true);
 	updateDlgCtrlTxt(_hSelf, IDC_COMPARE_TB,			str["IDC_COMPARE_TB"].c_str(), true);
@@ -388,6 +390,8 @@ void SettingsDialog::SetParams(UserSettings* settings)
 			settings->WrapAround ? BST_CHECKED : BST_UNCHECKED);
 	Button_SetCheck(::GetDlgItem(_hSelf, IDC_GOTO_FIRST_DIFF),
 			settings->GotoFirstDiff ? BST_CHECKED : BST_UNCHECKED);
+	Button_SetCheck(::GetDlgItem(_hSelf, IDC_FAST_APPROX_DIFF),
+			settings->FastApproxDiff ? BST_CHECKED : BST_UNCHECKED);
 
 	// Set current colors configured in option dialog
 	_ColorAdded.setColor(settings->colors().added);
@@ -473,6 +477,7 @@ void SettingsDialog::GetParams()
 	_Settings->FollowingCaret		= (Button_GetCheck(::GetDlgItem(_hSelf, IDC_FOLLOWING_CARET)) == BST_CHECKED);
 	_Settings->WrapAround			= (Button_GetCheck(::GetDlgItem(_hSelf, IDC_WRAP_AROUND)) == BST_CHECKED);
 	_Settings->GotoFirstDiff		= (Button_GetCheck(::GetDlgItem(_hSelf, IDC_GOTO_FIRST_DIFF)) == BST_CHECKED);
+	_Settings->FastApproxDiff		= (Button_GetCheck(::GetDlgItem(_hSelf, IDC_FAST_APPROX_DIFF)) == BST_CHECKED);
 
 	// Get color chosen in dialog
 	_Settings->colors().added			= _ColorAdded.getColor();
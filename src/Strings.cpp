@@ -106,6 +106,7 @@ Strings::Strings() : _localizationSuccessful {false}, _currentLocale {"english"}
 		{ "IDC_FOLLOWING_CARET",			"Move caret on navigation" },
 		{ "IDC_WRAP_AROUND",				"Wrap around diffs on navigation" },
 		{ "IDC_GOTO_FIRST_DIFF",			"Go to first diff after re-Compare" },
+		{ "IDC_FAST_APPROX_DIFF",			"Fast approximate diff of very different files" },
 		{ "IDC_COLORS",						"Coloring" },
 		{ "IDC_ADDED",						"Added line" },
 		{ "IDC_REMOVED",					"Removed line" },
@@ -40,6 +40,7 @@ const wchar_t UserSettings::markIgnoredLinesSetting[]		= L"never_colorize_ignore
 const wchar_t UserSettings::followingCaretSetting[]			= L"following_caret";
 const wchar_t UserSettings::wrapAroundSetting[]				= L"wrap_around";
 const wchar_t UserSettings::gotoFirstDiffSetting[]			= L"go_to_first_on_recompare";
+const wchar_t UserSettings::fastApproxDiffSetting[]			= L"fast_approximate_diff";
 
 const wchar_t UserSettings::detectMovesSetting[]			= L"detect_moves";
 const wchar_t UserSettings::detectSubBlockDiffsSetting[]	= L"detect_sub_block_diffs";
@@ -69,6 +70,9 @@ const wchar_t UserSettings::reCompareOnChangeSetting[]		= L"recompare_on_change"
 
 const wchar_t UserSettings::statusInfoSetting[]				= L"status_info";
 
+const wchar_t UserSettings::longLineLenSetting[]			= L"long_line_length";
+const wchar_t UserSettings::lineDiffSetting[]				= L"line_diff_algorithm";
+
 const wchar_t UserSettings::colorsSection[]					= L"color_settings";
 
 const wchar_t UserSettings::addedColorSetting[]				= L"added";
@@ -145,6 +149,8 @@ void UserSettings::load()
 			DEFAULT_WRAP_AROUND, ini) != 0;
 	GotoFirstDiff			= ::GetPrivateProfileIntW(mainSection, gotoFirstDiffSetting,
 			DEFAULT_GOTO_FIRST_DIFF, ini) != 0;
+	FastApproxDiff			= ::GetPrivateProfileIntW(mainSection, fastApproxDiffSetting,
+			DEFAULT_FAST_APPROX_DIFF, ini) != 0;
 
 	DetectMoves				= ::GetPrivateProfileIntW(mainSection, detectMovesSetting,			 1, ini) != 0;
 	DetectSubBlockDiffs		= ::GetPrivateProfileIntW(mainSection, detectSubBlockDiffsSetting,	 1, ini) != 0;
@@ -209,6 +215,17 @@ void UserSettings::load()
 	if (StatusInfo >= STATUS_TYPE_END)
 		StatusInfo = static_cast<StatusType>(DEFAULT_STATUS_INFO);
 
+	LongLineLen = ::GetPrivateProfileIntW(mainSection, longLineLenSetting, DEFAULT_LONG_LINE_LEN, ini);
+
+	if (LongLineLen < 0)
+		LongLineLen = DEFAULT_LONG_LINE_LEN;
+
+	LineDiff = static_cast<LineDiffType>(::GetPrivateProfileIntW(mainSection, lineDiffSetting,
+			DEFAULT_LINE_DIFF_TYPE, ini));
+
+	if (LineDiff < 0 || LineDiff >= LINE_DIFF_TYPE_END)
+		LineDiff = static_cast<LineDiffType>(DEFAULT_LINE_DIFF_TYPE);
+
 	colorsLight.added						= ::GetPrivateProfileIntW(colorsSection, addedColorSetting,
 			DEFAULT_ADDED_COLOR, ini);
 	colorsLight.removed						= ::GetPrivateProfileIntW(colorsSection, removedColorSetting,
@@ -325,6 +342,7 @@ void UserSettings::save()
 	::WritePrivateProfileStringW(mainSection, followingCaretSetting,		FollowingCaret		  ? L"1" : L"0", ini);
 	::WritePrivateProfileStringW(mainSection, wrapAroundSetting,			WrapAround			  ? L"1" : L"0", ini);
 	::WritePrivateProfileStringW(mainSection, gotoFirstDiffSetting,			GotoFirstDiff		  ? L"1" : L"0", ini);
+	::WritePrivateProfileStringW(mainSection, fastApproxDiffSetting,		FastApproxDiff		  ? L"1" : L"0", ini);
 
 	::WritePrivateProfileStringW(mainSection, detectMovesSetting,			DetectMoves			  ? L"1" : L"0", ini);
 	::WritePrivateProfileStringW(mainSection, detectSubBlockDiffsSetting,	DetectSubBlockDiffs	  ? L"1" : L"0", ini);
@@ -369,6 +387,12 @@ void UserSettings::save()
 	_itow_s(static_cast<int>(StatusInfo), buffer, 64, 10);
 	::WritePrivateProfileStringW(mainSection, statusInfoSetting, buffer, ini);
 
+	_itow_s(LongLineLen, buffer, 64, 10);
+	::WritePrivateProfileStringW(mainSection, longLineLenSetting, buffer, ini);
+
+	_itow_s(static_cast<int>(LineDiff), buffer, 64, 10);
+	::WritePrivateProfileStringW(mainSection, lineDiffSetting, buffer, ini);
+
 	_itow_s(colorsLight.added, buffer, 64, 10);
 	::WritePrivateProfileStringW(colorsSection, addedColorSetting, buffer, ini);
 
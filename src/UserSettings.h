@@ -37,9 +37,15 @@
 #define DEFAULT_FOLLOWING_CARET				1
 #define DEFAULT_WRAP_AROUND					0
 #define DEFAULT_GOTO_FIRST_DIFF				1
+#define DEFAULT_FAST_APPROX_DIFF			0
 
 #define DEFAULT_STATUS_INFO					0
 
+// Lines longer than that (in bytes) are compared in long-line mode (by tokens), 0 - disabled
+#define DEFAULT_LONG_LINE_LEN				10000
+
+#define DEFAULT_LINE_DIFF_TYPE				0
+
 #define DEFAULT_ADDED_COLOR					0xC6FFC6
 #define DEFAULT_REMOVED_COLOR				0xC6C6FF
 #define DEFAULT_MOVED_COLOR					0xFFE6CC
@@ -80,6 +86,16 @@ enum StatusType
 };
 
 
+// Line pass diff algorithm
+enum LineDiffType
+{
+	LINE_DIFF_MIXED = 0,
+	LINE_DIFF_PATIENCE,
+	LINE_DIFF_AUTO,
+	LINE_DIFF_TYPE_END
+};
+
+
 struct ColorSettings
 {
 	int added;
@@ -141,6 +157,7 @@ public:
 	bool			FollowingCaret;
 	bool			WrapAround;
 	bool			GotoFirstDiff;
+	bool			FastApproxDiff;
 
 	bool			DetectMoves;
 	bool			DetectSubBlockDiffs;
@@ -170,6 +187,9 @@ public:
 	bool			RecompareOnChange;
 	StatusType		StatusInfo;
 
+	int				LongLineLen;
+	LineDiffType	LineDiff;
+
 	int				ChangedResemblPercent;
 
 	bool			EnableToolbar;
@@ -199,6 +219,7 @@ private:
 	static const wchar_t followingCaretSetting[];
 	static const wchar_t wrapAroundSetting[];
 	static const wchar_t gotoFirstDiffSetting[];
+	static const wchar_t fastApproxDiffSetting[];
 
 	static const wchar_t detectMovesSetting[];
 	static const wchar_t detectSubBlockDiffsSetting[];
@@ -229,6 +250,9 @@ private:
 
 	static const wchar_t statusInfoSetting[];
 
+	static const wchar_t longLineLenSetting[];
+	static const wchar_t lineDiffSetting[];
+
 	static const wchar_t colorsSection[];
 
 	static const wchar_t addedColorSetting[];
@@ -171,6 +171,7 @@
 #define IDC_COMPARE_OPTIONS_TB			1075
 #define IDC_DIFFS_FILTERS_TB			1076
 #define IDC_NAV_BAR_TB					1077
+#define IDC_FAST_APPROX_DIFF			1078
 
 #define IDC_DETECT						1090
 #define IDC_DETECT_MOVES				1091